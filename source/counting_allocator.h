@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+struct MemoryUsage {
+    size_t byte_count = 0;
+    size_t block_count = 0;
+    // Bytes the heap spends on the blocks beyond the requested size: headers and rounding.
+    size_t estimated_overhead = 0;
+};
+
+// Allocation totals shared by all copies and rebinds of a CountingAllocator.
+// Counters are atomic, so they may be read while containers allocate in other threads.
+class AllocationCounter {
+public:
+    void Allocate(size_t byte_count) {
+        byte_count_.fetch_add(byte_count, std::memory_order_relaxed);
+        block_count_.fetch_add(1, std::memory_order_relaxed);
+        estimated_overhead_.fetch_add(EstimateOverhead(byte_count), std::memory_order_relaxed);
+    }
+
+    void Deallocate(size_t byte_count) {
+        byte_count_.fetch_sub(byte_count, std::memory_order_relaxed);
+        block_count_.fetch_sub(1, std::memory_order_relaxed);
+        estimated_overhead_.fetch_sub(EstimateOverhead(byte_count), std::memory_order_relaxed);
+    }
+
+    MemoryUsage GetUsage() const {
+        return { byte_count_.load(std::memory_order_relaxed), block_count_.load(std::memory_order_relaxed),
+                 estimated_overhead_.load(std::memory_order_relaxed) };
+    }
+
+private:
+    std::atomic<size_t> byte_count_ = 0;
+    std::atomic<size_t> block_count_ = 0;
+    std::atomic<size_t> estimated_overhead_ = 0;
+
+    // A malloc chunk is the request plus an 8-byte header, rounded up to 16 bytes, 32 bytes at least.
+    static size_t EstimateOverhead(size_t byte_count) {
+        const size_t chunk_size = (byte_count + sizeof(size_t) + 15) / 16 * 16;
+        return (chunk_size < 32 ? 32 : chunk_size) - byte_count;
+    }
+};
+
+// std::allocator that reports every allocation to an AllocationCounter.
+// A default-constructed allocator has no counter and counts nothing.
+// Move assignment hands the allocator over with the elements, so they are released to the counter they were taken from.
+template <typename T>
+class CountingAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+
+    CountingAllocator() noexcept = default;
+
+    CountingAllocator(AllocationCounter* counter) noexcept
+        : counter_(counter) {
+    }
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>& other) noexcept
+        : counter_(other.GetCounter()) {
+    }
+
+    T* allocate(size_t count) {
+        T* result = std::allocator<T>().allocate(count);
+        if (counter_ != nullptr) {
+            counter_->Allocate(count * sizeof(T));
+        }
+        return result;
+    }
+
+    void deallocate(T* pointer, size_t count) noexcept {
+        if (counter_ != nullptr) {
+            counter_->Deallocate(count * sizeof(T));
+        }
+        std::allocator<T>().deallocate(pointer, count);
+    }
+
+    AllocationCounter* GetCounter() const noexcept {
+        return counter_;
+    }
+
+private:
+    AllocationCounter* counter_ = nullptr;
+};
+
+template <typename T, typename U>
+bool operator==(const CountingAllocator<T>& lhs, const CountingAllocator<U>& rhs) noexcept {
+    return lhs.GetCounter() == rhs.GetCounter();
+}
+
+template <typename T, typename U>
+bool operator!=(const CountingAllocator<T>& lhs, const CountingAllocator<U>& rhs) noexcept {
+    return !(lhs == rhs);
+}
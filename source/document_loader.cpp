@@ -0,0 +1,549 @@
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bounded_queue.h"
+#include "document_loader.h"
+
+using namespace std;
+
+namespace {
+
+struct Chunk {
+    size_t index = 0;
+    string_view data;
+    // Owns data when the input is not mapped.
+    unique_ptr<string> buffer;
+};
+
+struct ParsedDocument {
+    int id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    vector<int> ratings;
+    string_view text;
+    string unescaped_text;
+    bool is_unescaped = false;
+    SearchServer::TokenizedDocument tokens;
+
+    string_view GetText() const {
+        return is_unescaped ? string_view(unescaped_text) : text;
+    }
+};
+
+struct ParsedChunk {
+    size_t index = 0;
+    string_view data;
+    unique_ptr<string> buffer;
+    // Documents up to the first malformed line, if any.
+    vector<ParsedDocument> documents;
+    exception_ptr error;
+};
+
+// A regular file is mapped into memory. Pipes, FIFOs and terminals have no size to map,
+// they are read in chunks instead.
+class InputFile {
+public:
+    explicit InputFile(const string& path)
+        : path_(path) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw runtime_error("cannot open "s + path + ": "s + strerror(errno));
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) < 0) {
+            close(fd);
+            throw runtime_error("cannot stat "s + path + ": "s + strerror(errno));
+        }
+        if (!S_ISREG(file_stat.st_mode)) {
+            fd_ = fd;
+            return;
+        }
+        size_ = static_cast<size_t>(file_stat.st_size);
+        if (size_ > 0) {
+            void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                close(fd);
+                throw runtime_error("cannot map "s + path + ": "s + strerror(errno));
+            }
+            data_ = static_cast<const char*>(data);
+            madvise(const_cast<char*>(data_), size_, MADV_SEQUENTIAL);
+        }
+        close(fd);
+    }
+
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+
+    ~InputFile() {
+        if (data_ != nullptr) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    bool IsMapped() const {
+        return fd_ < 0;
+    }
+
+    string_view GetData() const {
+        return { data_, size_ };
+    }
+
+    // Appends up to size bytes of an input that is not mapped. Returns false at the end of the input.
+    bool Read(size_t size, string& output) const {
+        const size_t old_size = output.size();
+        output.resize(old_size + size);
+        while (true) {
+            const ssize_t read_size = read(fd_, output.data() + old_size, size);
+            if (read_size < 0 && errno == EINTR) {
+                continue;
+            }
+            if (read_size < 0) {
+                output.resize(old_size);
+                throw runtime_error("cannot read "s + path_ + ": "s + strerror(errno));
+            }
+            output.resize(old_size + read_size);
+            return read_size > 0;
+        }
+    }
+
+    // Drops the mapped pages that lie entirely inside range from memory.
+    void Release(string_view range) const {
+        if (data_ == nullptr) {
+            return;
+        }
+        const uintptr_t page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        const uintptr_t begin = (reinterpret_cast<uintptr_t>(range.data()) + page_size - 1) / page_size * page_size;
+        const uintptr_t end = (reinterpret_cast<uintptr_t>(range.data()) + range.size()) / page_size * page_size;
+        if (begin < end) {
+            madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+        }
+    }
+
+private:
+    const string path_;
+    int fd_ = -1;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+int ParseInt(string_view text) {
+    int value = 0;
+    const auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+    if (error != errc() || end != text.data() + text.size()) {
+        throw invalid_argument("wrong number: " + string(text));
+    }
+    return value;
+}
+
+DocumentStatus ParseStatus(string_view text) {
+    if (text == "ACTUAL") {
+        return DocumentStatus::ACTUAL;
+    }
+    if (text == "IRRELEVANT") {
+        return DocumentStatus::IRRELEVANT;
+    }
+    if (text == "BANNED") {
+        return DocumentStatus::BANNED;
+    }
+    if (text == "REMOVED") {
+        return DocumentStatus::REMOVED;
+    }
+    throw invalid_argument("wrong document status: " + string(text));
+}
+
+ParsedDocument ParseTsvLine(string_view line) {
+    string_view fields[3];
+    for (string_view& field : fields) {
+        const size_t tab = line.find('\t');
+        if (tab == line.npos) {
+            throw invalid_argument("line must have 4 tab-separated fields: " + string(line));
+        }
+        field = line.substr(0, tab);
+        line.remove_prefix(tab + 1);
+    }
+    ParsedDocument document;
+    document.id = ParseInt(fields[0]);
+    document.status = ParseStatus(fields[1]);
+    for (const string_view rating : SplitIntoWords(fields[2])) {
+        document.ratings.push_back(ParseInt(rating));
+    }
+    document.text = line;
+    return document;
+}
+
+class JsonLineParser {
+public:
+    explicit JsonLineParser(string_view line)
+        : line_(line) {
+    }
+
+    ParsedDocument Parse() {
+        ParsedDocument document;
+        bool has_id = false;
+        bool has_text = false;
+        Expect('{');
+        if (!Consume('}')) {
+            do {
+                string unescaped_key;
+                const string_view key = ParseString(unescaped_key);
+                Expect(':');
+                if (key == "id") {
+                    document.id = ParseInt(ParseNumber());
+                    has_id = true;
+                } else if (key == "status") {
+                    string unescaped_status;
+                    document.status = ParseStatus(ParseString(unescaped_status));
+                } else if (key == "ratings") {
+                    Expect('[');
+                    if (!Consume(']')) {
+                        do {
+                            document.ratings.push_back(ParseInt(ParseNumber()));
+                        } while (Consume(','));
+                        Expect(']');
+                    }
+                } else if (key == "text") {
+                    document.text = ParseString(document.unescaped_text);
+                    document.is_unescaped = document.text.data() == document.unescaped_text.data();
+                    has_text = true;
+                } else {
+                    SkipValue();
+                }
+            } while (Consume(','));
+            Expect('}');
+        }
+        SkipSpaces();
+        if (position_ != line_.size()) {
+            Fail("unexpected characters after the object");
+        }
+        if (!has_id || !has_text) {
+            Fail("\"id\" and \"text\" are required");
+        }
+        return document;
+    }
+
+private:
+    string_view line_;
+    size_t position_ = 0;
+
+    [[noreturn]] void Fail(const string& reason) const {
+        throw invalid_argument("wrong JSON line (" + reason + "): " + string(line_));
+    }
+
+    void SkipSpaces() {
+        while (position_ < line_.size() && (line_[position_] == ' ' || line_[position_] == '\t')) {
+            ++position_;
+        }
+    }
+
+    bool Consume(char c) {
+        SkipSpaces();
+        if (position_ < line_.size() && line_[position_] == c) {
+            ++position_;
+            return true;
+        }
+        return false;
+    }
+
+    void Expect(char c) {
+        if (!Consume(c)) {
+            Fail("'"s + c + "' expected"s);
+        }
+    }
+
+    string_view ParseNumber() {
+        SkipSpaces();
+        const size_t begin = position_;
+        while (position_ < line_.size() && (isdigit(static_cast<unsigned char>(line_[position_])) || line_[position_] == '-')) {
+            ++position_;
+        }
+        return line_.substr(begin, position_ - begin);
+    }
+
+    // Returns a view into the line, or into unescaped if the string has escape sequences.
+    string_view ParseString(string& unescaped) {
+        Expect('"');
+        const size_t begin = position_;
+        while (position_ < line_.size() && line_[position_] != '"' && line_[position_] != '\\') {
+            ++position_;
+        }
+        if (position_ == line_.size()) {
+            Fail("string is not closed");
+        }
+        if (line_[position_] == '"') {
+            return line_.substr(begin, position_++ - begin);
+        }
+        unescaped.assign(line_.substr(begin, position_ - begin));
+        while (position_ < line_.size() && line_[position_] != '"') {
+            if (line_[position_] != '\\') {
+                unescaped.push_back(line_[position_++]);
+                continue;
+            }
+            if (++position_ == line_.size()) {
+                break;
+            }
+            const char escaped = line_[position_++];
+            switch (escaped) {
+            case 'b': unescaped.push_back('\b'); break;
+            case 'f': unescaped.push_back('\f'); break;
+            case 'n': unescaped.push_back('\n'); break;
+            case 'r': unescaped.push_back('\r'); break;
+            case 't': unescaped.push_back('\t'); break;
+            case 'u': AppendUtf8(ParseCodePoint(), unescaped); break;
+            default: unescaped.push_back(escaped); break;
+            }
+        }
+        if (position_ == line_.size()) {
+            Fail("string is not closed");
+        }
+        ++position_;
+        return unescaped;
+    }
+
+    uint32_t ParseHex4() {
+        if (position_ + 4 > line_.size()) {
+            Fail("wrong \\u escape");
+        }
+        uint32_t value = 0;
+        const auto [end, error] = from_chars(line_.data() + position_, line_.data() + position_ + 4, value, 16);
+        if (error != errc() || end != line_.data() + position_ + 4) {
+            Fail("wrong \\u escape");
+        }
+        position_ += 4;
+        return value;
+    }
+
+    uint32_t ParseCodePoint() {
+        const uint32_t high = ParseHex4();
+        if (high >= 0xD800 && high < 0xDC00 && line_.substr(position_, 2) == "\\u") {
+            position_ += 2;
+            const uint32_t low = ParseHex4();
+            return 0x10000 + ((high - 0xD800) << 10) + (low - 0xDC00);
+        }
+        return high;
+    }
+
+    static void AppendUtf8(uint32_t code_point, string& output) {
+        if (code_point < 0x80) {
+            output.push_back(static_cast<char>(code_point));
+        } else if (code_point < 0x800) {
+            output.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+            output.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        } else if (code_point < 0x10000) {
+            output.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+            output.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        } else {
+            output.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+            output.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        }
+    }
+
+    void SkipValue() {
+        SkipSpaces();
+        int depth = 0;
+        while (position_ < line_.size()) {
+            const char c = line_[position_];
+            if (c == '"') {
+                string ignored;
+                ParseString(ignored);
+                if (depth == 0) {
+                    return;
+                }
+                continue;
+            }
+            if (depth == 0 && (c == ',' || c == '}')) {
+                return;
+            }
+            if (c == '[' || c == '{') {
+                ++depth;
+            } else if (c == ']' || c == '}') {
+                --depth;
+            }
+            ++position_;
+        }
+    }
+};
+
+void ParseChunk(ParsedChunk& chunk, InputFormat format) {
+    string_view rest = chunk.data;
+    while (!rest.empty()) {
+        const size_t line_end = rest.find('\n');
+        string_view line = rest.substr(0, line_end);
+        rest.remove_prefix(line_end == rest.npos ? rest.size() : line_end + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.find_first_not_of(" \t") == line.npos) {
+            continue;
+        }
+        chunk.documents.push_back(format == InputFormat::TSV ? ParseTsvLine(line) : JsonLineParser(line).Parse());
+    }
+}
+
+// Tokenizes the documents of a parsed chunk. A document that fails keeps only the ones before it,
+// so it is reported after them, like a malformed line.
+void TokenizeChunk(const SearchServer& search_server, ParsedChunk& chunk) {
+    for (size_t i = 0; i < chunk.documents.size(); ++i) {
+        try {
+            chunk.documents[i].tokens = search_server.Tokenize(chunk.documents[i].GetText());
+        } catch (...) {
+            chunk.documents.resize(i);
+            chunk.error = current_exception();
+            return;
+        }
+    }
+}
+
+}  // namespace
+
+LoadStatistics LoadDocuments(SearchServer& search_server, const string& path, InputFormat format, size_t parser_count) {
+    if (parser_count == 0) {
+        throw invalid_argument("parser count must be positive");
+    }
+    const InputFile file(path);
+
+    BoundedQueue<Chunk> chunks(LOADER_QUEUE_CAPACITY);
+    BoundedQueue<ParsedChunk> parsed_chunks(LOADER_QUEUE_CAPACITY);
+    // Limits how far reading may run ahead of indexing, parsed chunks wait here to be indexed in order.
+    BoundedQueue<bool> chunks_in_flight(2 * LOADER_QUEUE_CAPACITY + parser_count);
+
+    exception_ptr read_error;
+    thread reader([&] {
+        size_t index = 0;
+        const auto push_chunk = [&](string_view data, unique_ptr<string> buffer) {
+            return chunks_in_flight.Push(true) && chunks.Push({ index++, data, move(buffer) });
+        };
+        try {
+            if (file.IsMapped()) {
+                const string_view data = file.GetData();
+                for (size_t begin = 0; begin < data.size(); ) {
+                    size_t end = begin + LOADER_CHUNK_SIZE;
+                    if (end >= data.size()) {
+                        end = data.size();
+                    } else {
+                        const size_t line_end = data.find('\n', end);
+                        end = line_end == data.npos ? data.size() : line_end + 1;
+                    }
+                    if (!push_chunk(data.substr(begin, end - begin), nullptr)) {
+                        break;
+                    }
+                    begin = end;
+                }
+            } else {
+                // A chunk ends after its last complete line, the rest starts the next chunk.
+                string rest;
+                bool is_end = false;
+                while (!is_end) {
+                    const size_t chunk_size = rest.size() + LOADER_CHUNK_SIZE;
+                    auto buffer = make_unique<string>(move(rest));
+                    rest.clear();
+                    while (buffer->size() < chunk_size && !is_end) {
+                        is_end = !file.Read(chunk_size - buffer->size(), *buffer);
+                    }
+                    const size_t line_end = buffer->rfind('\n');
+                    if (!is_end) {
+                        if (line_end == string::npos) {
+                            rest = move(*buffer);
+                            continue;
+                        }
+                        rest.assign(*buffer, line_end + 1);
+                        buffer->resize(line_end + 1);
+                    }
+                    const string_view data = *buffer;
+                    if (!data.empty() && !push_chunk(data, move(buffer))) {
+                        break;
+                    }
+                }
+            }
+        } catch (...) {
+            read_error = current_exception();
+        }
+        chunks.Close();
+    });
+
+    atomic<size_t> active_parser_count = parser_count;
+    vector<thread> parsers;
+    for (size_t i = 0; i < parser_count; ++i) {
+        parsers.emplace_back([&] {
+            while (auto chunk = chunks.Pop()) {
+                ParsedChunk parsed_chunk;
+                parsed_chunk.index = chunk->index;
+                parsed_chunk.data = chunk->data;
+                parsed_chunk.buffer = move(chunk->buffer);
+                try {
+                    ParseChunk(parsed_chunk, format);
+                } catch (...) {
+                    parsed_chunk.error = current_exception();
+                }
+                // The documents are tokenized once the chunk stops growing, as they view into it.
+                TokenizeChunk(search_server, parsed_chunk);
+                if (!parsed_chunks.Push(move(parsed_chunk))) {
+                    break;
+                }
+            }
+            if (--active_parser_count == 0) {
+                parsed_chunks.Close();
+            }
+        });
+    }
+
+    const auto stop_pipeline = [&] {
+        chunks_in_flight.Close();
+        chunks.Close();
+        parsed_chunks.Close();
+        reader.join();
+        for (thread& parser : parsers) {
+            parser.join();
+        }
+    };
+
+    LoadStatistics statistics;
+    try {
+        map<size_t, ParsedChunk> waiting_chunks;
+        size_t next_index = 0;
+        while (auto parsed_chunk = parsed_chunks.Pop()) {
+            waiting_chunks.emplace(parsed_chunk->index, move(*parsed_chunk));
+            for (auto it = waiting_chunks.find(next_index); it != waiting_chunks.end(); it = waiting_chunks.find(next_index)) {
+                const ParsedChunk& chunk = it->second;
+                for (const ParsedDocument& document : chunk.documents) {
+                    search_server.AddDocument(document.id, document.tokens, document.status, document.ratings);
+                }
+                if (chunk.error) {
+                    rethrow_exception(chunk.error);
+                }
+                statistics.document_count += chunk.documents.size();
+                statistics.byte_count += chunk.data.size();
+                file.Release(chunk.data);
+                waiting_chunks.erase(it);
+                chunks_in_flight.Pop();
+                ++next_index;
+            }
+        }
+    } catch (...) {
+        stop_pipeline();
+        throw;
+    }
+    stop_pipeline();
+    if (read_error) {
+        rethrow_exception(read_error);
+    }
+    return statistics;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+#include "search_server.h"
+
+const size_t LOADER_CHUNK_SIZE = 4 * 1024 * 1024;
+const size_t LOADER_QUEUE_CAPACITY = 4;
+
+enum class InputFormat {
+    // id <TAB> status <TAB> space-separated ratings <TAB> text
+    TSV,
+    // {"id": 1, "status": "ACTUAL", "ratings": [1, 2], "text": "..."}
+    JSONL,
+};
+
+struct LoadStatistics {
+    size_t document_count = 0;
+    size_t byte_count = 0;
+};
+
+// Adds every line of a TSV or JSONL dump to search_server. A regular file is mapped into memory,
+// a pipe or FIFO such as /dev/stdin is read in chunks. Parser threads parse and tokenize
+// the chunks, and the calling thread indexes the documents in file order. The stages are
+// connected by bounded queues and indexed chunks are released from memory, so memory use
+// does not grow with the input size.
+// Throws invalid_argument for a malformed line after indexing every document before it,
+// and rethrows whatever AddDocument throws.
+LoadStatistics LoadDocuments(SearchServer& search_server, const std::string& path, InputFormat format,
+                             size_t parser_count = 2);
@@ -0,0 +1,107 @@
+#include <filesystem>
+#include <stdexcept>
+
+#include "durable_search_server.h"
+
+using namespace std;
+
+namespace {
+
+string CreateDirectory(const string& directory) {
+    filesystem::create_directories(directory);
+    return directory;
+}
+
+}  // namespace
+
+DurableSearchServer::DurableSearchServer(SearchServer& search_server, const string& directory)
+    : search_server_(search_server)
+    , directory_(CreateDirectory(directory))
+    , snapshot_path_(directory_ + "/snapshot"s)
+    , snapshot_lsn_(LoadSnapshot())
+    , log_(directory_ + "/wal"s, snapshot_lsn_) {
+    ReplayLog();
+}
+
+void DurableSearchServer::AddDocument(int document_id, const string_view& document, DocumentStatus status,
+                                      const vector<int>& ratings) {
+    uint64_t lsn = 0;
+    {
+        lock_guard lock(mutex_);
+        log_.CheckHealth();
+        search_server_.AddDocument(document_id, document, status, ratings);
+        lsn = log_.Append({ 0, LogOperation::ADD, document_id, status, ratings, string(document) });
+    }
+    log_.WaitDurable(lsn);
+}
+
+void DurableSearchServer::RemoveDocument(int document_id) {
+    uint64_t lsn = 0;
+    {
+        lock_guard lock(mutex_);
+        log_.CheckHealth();
+        search_server_.RemoveDocument(document_id);
+        lsn = log_.Append({ 0, LogOperation::REMOVE, document_id, DocumentStatus::ACTUAL, {}, {} });
+    }
+    log_.WaitDurable(lsn);
+}
+
+void DurableSearchServer::Checkpoint() {
+    lock_guard lock(mutex_);
+    log_.CheckHealth();
+    const uint64_t lsn = log_.GetLastLsn();
+    string snapshot;
+    SerializeLogRecord({ lsn, LogOperation::CHECKPOINT, search_server_.GetDocumentCount(), DocumentStatus::ACTUAL, {}, {} },
+                       snapshot);
+    for (const int document_id : search_server_) {
+        const auto [text, status, rating] = search_server_.GetDocument(document_id);
+        SerializeLogRecord({ lsn, LogOperation::ADD, document_id, status, { rating }, string(text) }, snapshot);
+    }
+    ReplaceLogFile(snapshot_path_, snapshot);
+    snapshot_lsn_ = lsn;
+    log_.Truncate(lsn);
+}
+
+uint64_t DurableSearchServer::GetLastLsn() const {
+    return log_.GetLastLsn();
+}
+
+const RecoveryStatistics& DurableSearchServer::GetRecoveryStatistics() const {
+    return recovery_statistics_;
+}
+
+uint64_t DurableSearchServer::LoadSnapshot() {
+    if (search_server_.GetDocumentCount() > 0) {
+        throw invalid_argument("search server must be empty to be restored");
+    }
+    const string data = ReadLogFile(snapshot_path_);
+    if (data.empty()) {
+        return 0;
+    }
+    size_t valid_size = 0;
+    const vector<LogRecord> records = ParseLogRecords(data, valid_size);
+    if (valid_size != data.size() || records.empty() || records[0].operation != LogOperation::CHECKPOINT
+        || static_cast<size_t>(records[0].document_id) != records.size() - 1) {
+        throw runtime_error("snapshot "s + snapshot_path_ + " is corrupted"s);
+    }
+    for (size_t i = 1; i < records.size(); ++i) {
+        const LogRecord& record = records[i];
+        search_server_.AddDocument(record.document_id, record.text, record.status, record.ratings);
+    }
+    recovery_statistics_.snapshot_document_count = records.size() - 1;
+    return records[0].lsn;
+}
+
+void DurableSearchServer::ReplayLog() {
+    for (const LogRecord& record : log_.GetRecoveredRecords()) {
+        if (record.lsn <= snapshot_lsn_) {
+            continue;
+        }
+        if (record.operation == LogOperation::ADD) {
+            search_server_.AddDocument(record.document_id, record.text, record.status, record.ratings);
+        } else if (record.operation == LogOperation::REMOVE) {
+            search_server_.RemoveDocument(record.document_id);
+        }
+        ++recovery_statistics_.replayed_record_count;
+    }
+}
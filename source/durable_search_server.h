@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "search_server.h"
+#include "write_ahead_log.h"
+
+struct RecoveryStatistics {
+    size_t snapshot_document_count = 0;
+    size_t replayed_record_count = 0;
+};
+
+// Makes the mutations of a SearchServer survive a crash. The directory holds a snapshot
+// and a write-ahead log of the mutations made after it. A mutation is applied to the
+// server first, so a rejected one is never logged, and returns once its record is on disk.
+// Concurrent mutations are synced together. Once writing the log fails, the failed
+// mutations stay in memory, but every later mutation and checkpoint throws runtime_error
+// before changing anything; reopening the directory restores the durable state.
+// Queries go to the server directly and are not synchronized with mutations,
+// as for a plain SearchServer.
+class DurableSearchServer {
+public:
+    // Restores search_server, which must be empty, from the snapshot and the log in directory.
+    DurableSearchServer(SearchServer& search_server, const std::string& directory);
+
+    void AddDocument(int document_id, const std::string_view& document, DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    // Writes a snapshot of the server and drops the log records it covers.
+    void Checkpoint();
+
+    uint64_t GetLastLsn() const;
+
+    const RecoveryStatistics& GetRecoveryStatistics() const;
+
+private:
+    SearchServer& search_server_;
+    const std::string directory_;
+    const std::string snapshot_path_;
+    RecoveryStatistics recovery_statistics_;
+    uint64_t snapshot_lsn_ = 0;
+    std::mutex mutex_;
+    WriteAheadLog log_;
+
+    uint64_t LoadSnapshot();
+
+    void ReplayLog();
+};
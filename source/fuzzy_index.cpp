@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <numeric>
+
+#include "fuzzy_index.h"
+
+using namespace std;
+
+namespace {
+
+int ComputeEditDistance(const string_view& lhs, const string_view& rhs, int max_distance) {
+    if (static_cast<int>(max(lhs.size(), rhs.size()) - min(lhs.size(), rhs.size())) > max_distance) {
+        return max_distance + 1;
+    }
+    vector<int> before_previous(rhs.size() + 1);
+    vector<int> previous(rhs.size() + 1);
+    vector<int> current(rhs.size() + 1);
+    iota(previous.begin(), previous.end(), 0);
+    for (size_t i = 1; i <= lhs.size(); ++i) {
+        current[0] = static_cast<int>(i);
+        int row_min = current[0];
+        for (size_t j = 1; j <= rhs.size(); ++j) {
+            const int cost = lhs[i - 1] == rhs[j - 1] ? 0 : 1;
+            current[j] = min({ previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost });
+            if (i > 1 && j > 1 && lhs[i - 1] == rhs[j - 2] && lhs[i - 2] == rhs[j - 1]) {
+                current[j] = min(current[j], before_previous[j - 2] + 1);
+            }
+            row_min = min(row_min, current[j]);
+        }
+        if (row_min > max_distance) {
+            return max_distance + 1;
+        }
+        swap(before_previous, previous);
+        swap(previous, current);
+    }
+    return previous[rhs.size()];
+}
+
+}  // namespace
+
+FuzzyIndex::FuzzyIndex(int max_distance)
+    : max_distance_(max_distance) {
+}
+
+vector<set<string>> FuzzyIndex::GenerateDeletes(const string_view& word, int max_distance) const {
+    vector<set<string>> deletes(max_distance + 1);
+    deletes[0].insert(string(word));
+    for (int distance = 1; distance <= max_distance; ++distance) {
+        for (const string& source : deletes[distance - 1]) {
+            if (source.size() <= 1) {
+                continue;
+            }
+            for (size_t i = 0; i < source.size(); ++i) {
+                deletes[distance].insert(source.substr(0, i) + source.substr(i + 1));
+            }
+        }
+    }
+    return deletes;
+}
+
+void FuzzyIndex::AddWord(const string_view& word) {
+    const auto [it, inserted] = words_.emplace(word);
+    if (!inserted) {
+        return;
+    }
+    set<string> all_deletes;
+    for (auto& level : GenerateDeletes(word, max_distance_)) {
+        all_deletes.merge(level);
+    }
+    for (const string& deleted : all_deletes) {
+        deletes_[deleted].push_back(*it);
+    }
+}
+
+void FuzzyIndex::RemoveWord(const string_view& word) {
+    const auto it = words_.find(word);
+    if (it == words_.end()) {
+        return;
+    }
+    set<string> all_deletes;
+    for (auto& level : GenerateDeletes(word, max_distance_)) {
+        all_deletes.merge(level);
+    }
+    for (const string& deleted : all_deletes) {
+        const auto deletes_it = deletes_.find(deleted);
+        auto& words = deletes_it->second;
+        words.erase(remove(words.begin(), words.end(), string_view(*it)), words.end());
+        if (words.empty()) {
+            deletes_.erase(deletes_it);
+        }
+    }
+    words_.erase(it);
+}
+
+vector<pair<string_view, int>> FuzzyIndex::FindWords(const string_view& word,
+                                                     size_t max_count,
+                                                     size_t max_candidates) const {
+    const int max_distance = min(max_distance_, static_cast<int>(word.size() / 3));
+    map<string_view, int> found;
+    size_t checked_count = 0;
+    for (const set<string>& level : GenerateDeletes(word, max_distance)) {
+        for (const string& deleted : level) {
+            const auto it = deletes_.find(deleted);
+            if (it == deletes_.end()) {
+                continue;
+            }
+            for (const string_view& candidate : it->second) {
+                if (found.count(candidate) || checked_count == max_candidates) {
+                    continue;
+                }
+                ++checked_count;
+                found.emplace(candidate, ComputeEditDistance(word, candidate, max_distance));
+            }
+        }
+    }
+    vector<pair<string_view, int>> result;
+    for (const auto& [candidate, distance] : found) {
+        if (distance <= max_distance) {
+            result.emplace_back(candidate, distance);
+        }
+    }
+    sort(result.begin(), result.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second < rhs.second || (lhs.second == rhs.second && lhs.first < rhs.first);
+    });
+    if (result.size() > max_count) {
+        result.resize(max_count);
+    }
+    return result;
+}
+
+int FuzzyIndex::GetMaxDistance() const {
+    return max_distance_;
+}
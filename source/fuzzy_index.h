@@ -0,0 +1,33 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Dictionary of index words for typo-tolerant lookup (SymSpell deletion index):
+// every word is stored under all strings obtained by deleting up to max_distance
+// characters, so a lookup only probes the deletions of the query word.
+class FuzzyIndex {
+public:
+    explicit FuzzyIndex(int max_distance);
+
+    void AddWord(const std::string_view& word);
+
+    void RemoveWord(const std::string_view& word);
+
+    std::vector<std::pair<std::string_view, int>> FindWords(const std::string_view& word,
+                                                           size_t max_count,
+                                                           size_t max_candidates) const;
+
+    int GetMaxDistance() const;
+
+private:
+    int max_distance_;
+    std::set<std::string, std::less<>> words_;
+    std::map<std::string, std::vector<std::string_view>, std::less<>> deletes_;
+
+    std::vector<std::set<std::string>> GenerateDeletes(const std::string_view& word, int max_distance) const;
+};
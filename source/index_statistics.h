@@ -0,0 +1,21 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "counting_allocator.h"
+
+const size_t POSTING_HISTOGRAM_SIZE = 32;
+
+struct IndexStatistics {
+    int document_count = 0;
+    size_t term_count = 0;
+    size_t posting_count = 0;
+    // Element i is the number of terms found in [2^i, 2^(i+1)) documents.
+    std::array<size_t, POSTING_HISTOGRAM_SIZE> posting_length_histogram{};
+    MemoryUsage word_to_document_freqs;
+    MemoryUsage document_to_word_freqs;
+    // Nodes of the document map with the metadata, document text is counted separately.
+    MemoryUsage documents;
+    size_t document_text_bytes = 0;
+};
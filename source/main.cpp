@@ -1,12 +1,25 @@
 #include <execution>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <optional>
 #include <random>
+#include <set>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "search_server.h"
+#include "document_loader.h"
+#include "durable_search_server.h"
 #include "log_duration.h"
 #include "process_queries.h"
+#include "search_cursor.h"
+#include "sharded_search_server.h"
+#include "stop_word_set.h"
 
 using namespace std;
 
@@ -53,18 +66,362 @@ vector<string> GenerateQueries(mt19937& generator, const vector<string>& diction
     return queries;
 }
 
-template <typename ExecutionPolicy>
-void Test(string_view mark, const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
+vector<string> GeneratePrefixQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int word_count, size_t prefix_length) {
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        string query;
+        for (int j = 0; j < word_count; ++j) {
+            if (!query.empty()) {
+                query.push_back(' ');
+            }
+            query += dictionary[uniform_int_distribution<int>(0, int(dictionary.size()) - 1)(generator)].substr(0, prefix_length);
+            query.push_back('*');
+        }
+        queries.push_back(query);
+    }
+    return queries;
+}
+
+template <typename ExecutionPolicy, typename RankingModel = TfIdfRanking>
+void Test(string_view mark, const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy,
+          RankingModel ranking_model = {}) {
     LOG_DURATION(mark);
+    const auto is_actual = [](int document_id, DocumentStatus status, int rating) {
+        return status == DocumentStatus::ACTUAL;
+    };
     double total_relevance = 0;
     for (const string_view query : queries) {
-        for (const auto& document : search_server.FindTopDocuments(policy, query)) {
+        for (const auto& document : search_server.FindTopDocuments(policy, query, is_actual, ranking_model)) {
+            total_relevance += document.relevance;
+        }
+    }
+    cout << total_relevance << endl;
+}
+
+// Also checks that MatchDocuments returns for every id what MatchDocument returns for it.
+void TestMatch(string_view mark, const SearchServer& search_server, const vector<string>& queries, int document_count) {
+    vector<int> document_ids(document_count);
+    iota(document_ids.begin(), document_ids.end(), 0);
+    vector<SearchServer::Matches> matches;
+    {
+        LOG_DURATION(mark);
+        size_t word_count = 0;
+        for (const string_view query : queries) {
+            search_server.MatchDocuments(execution::par, query, document_ids, matches);
+            for (const auto& [words, status] : matches) {
+                word_count += words.size();
+            }
+        }
+        cout << word_count << endl;
+    }
+    for (const string_view query : queries) {
+        search_server.MatchDocuments(execution::par, query, document_ids, matches);
+        for (size_t i = 0; i < document_ids.size(); ++i) {
+            if (matches.at(i) != search_server.MatchDocument(query, document_ids[i])) {
+                throw logic_error("MatchDocuments differs from MatchDocument for document "s + to_string(document_ids[i]));
+            }
+        }
+    }
+}
+
+void TestAdd(string_view mark, const vector<string>& documents, const vector<string>& stop_words) {
+    LOG_DURATION(mark);
+    SearchServer search_server(stop_words);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(int(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+    }
+    cout << search_server.GetDocumentCount() << endl;
+}
+
+// Checks that StopWordSet answers as a std::set lookup for the stop words and for random words.
+void TestStopWordSet(string_view mark, const vector<string>& stop_words, int random_word_count) {
+    mt19937 generator;
+    vector<string> words(stop_words.begin(), stop_words.end());
+    for (int i = 0; i < random_word_count; ++i) {
+        words.push_back(GenerateWord(generator, 12));
+    }
+    const set<string, less<>> expected(stop_words.begin(), stop_words.end());
+    const StopWordSet stop_word_set(expected);
+    LOG_DURATION(mark);
+    size_t stop_word_count = 0;
+    for (const string& word : words) {
+        const bool is_stop_word = stop_word_set.Contains(word);
+        if (is_stop_word != (expected.count(word) > 0)) {
+            throw logic_error("StopWordSet is wrong for word "s + word);
+        }
+        stop_word_count += is_stop_word;
+    }
+    cout << stop_word_count << endl;
+}
+
+void TestLoad(string_view mark, const vector<string>& documents, const string& stop_words) {
+    const filesystem::path path = filesystem::temp_directory_path() / "search_server_documents.tsv";
+    {
+        ofstream output(path);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            output << i << "\tACTUAL\t1 2 3\t"s << documents[i] << '\n';
+        }
+    }
+    SearchServer search_server(stop_words);
+    LoadStatistics statistics;
+    {
+        LOG_DURATION(mark);
+        statistics = LoadDocuments(search_server, path.string(), InputFormat::TSV);
+    }
+    cout << statistics.document_count << " documents, "s << statistics.byte_count << " bytes"s << endl;
+    filesystem::remove(path);
+}
+
+void AddDurably(DurableSearchServer& durable_server, const vector<string>& documents, int first_id, int thread_count) {
+    vector<thread> threads;
+    for (int i = 0; i < thread_count; ++i) {
+        threads.emplace_back([&, i] {
+            for (size_t j = i; j < documents.size(); j += thread_count) {
+                durable_server.AddDocument(first_id + int(j), documents[j], DocumentStatus::ACTUAL, { 1, 2, 3 });
+            }
+        });
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+}
+
+void TestDurable(const vector<string>& documents, const string& stop_words) {
+    const filesystem::path directory = filesystem::temp_directory_path() / "search_server_durable";
+    filesystem::remove_all(directory);
+    const int half_count = int(documents.size()) / 2;
+    const vector<string> first_half(documents.begin(), documents.begin() + half_count);
+    const vector<string> second_half(documents.begin() + half_count, documents.end());
+    {
+        SearchServer search_server(stop_words);
+        DurableSearchServer durable_server(search_server, directory.string());
+        {
+            LOG_DURATION("durable add, 1 thread"sv);
+            AddDurably(durable_server, first_half, 0, 1);
+        }
+        {
+            LOG_DURATION("durable add, 8 threads"sv);
+            AddDurably(durable_server, second_half, half_count, 8);
+        }
+    }
+    {
+        SearchServer search_server(stop_words);
+        optional<DurableSearchServer> durable_server;
+        {
+            LOG_DURATION("recovery from log"sv);
+            durable_server.emplace(search_server, directory.string());
+        }
+        cout << durable_server->GetRecoveryStatistics().replayed_record_count << " records replayed"s << endl;
+        // Rejected mutations must leave nothing behind for the checkpoint to save.
+        for (const auto& [document_id, text] : { pair{ int(documents.size()), "bad\x01word"s }, pair{ 0, "duplicate"s } }) {
+            try {
+                durable_server->AddDocument(document_id, text, DocumentStatus::ACTUAL, { 1 });
+                throw logic_error("rejected document "s + to_string(document_id) + " was added"s);
+            } catch (const invalid_argument&) {
+            }
+        }
+        LOG_DURATION("checkpoint"sv);
+        durable_server->Checkpoint();
+    }
+    {
+        SearchServer search_server(stop_words);
+        LOG_DURATION("recovery from snapshot"sv);
+        DurableSearchServer durable_server(search_server, directory.string());
+        cout << durable_server.GetRecoveryStatistics().snapshot_document_count << " documents in snapshot"s << endl;
+        if (search_server.GetDocumentCount() != int(documents.size())) {
+            throw logic_error("recovered "s + to_string(search_server.GetDocumentCount()) + " documents of "s +
+                              to_string(documents.size()));
+        }
+    }
+    filesystem::remove_all(directory);
+}
+
+// Checks that a sharded server returns exactly the documents and relevances of a single server.
+template <typename RankingModel = TfIdfRanking>
+void TestSharded(string_view mark, const SearchServer& search_server, const ShardedSearchServer& sharded_server,
+                 const vector<string>& queries, RankingModel ranking_model = {}) {
+    const auto is_actual = [](int document_id, DocumentStatus status, int rating) {
+        return status == DocumentStatus::ACTUAL;
+    };
+    vector<vector<Document>> sharded_results;
+    {
+        LOG_DURATION(mark);
+        for (const string_view query : queries) {
+            sharded_results.push_back(sharded_server.FindTopDocuments(query, is_actual, ranking_model));
+        }
+    }
+    double total_relevance = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto expected = search_server.FindTopDocuments(queries[i], is_actual, ranking_model);
+        const auto& actual = sharded_results[i];
+        const bool is_equal = equal(expected.begin(), expected.end(), actual.begin(), actual.end(),
+                                    [](const Document& lhs, const Document& rhs) {
+                                        return lhs.id == rhs.id && lhs.relevance == rhs.relevance && lhs.rating == rhs.rating;
+                                    });
+        if (!is_equal) {
+            throw logic_error("sharded results differ from a single server for query "s + queries[i]);
+        }
+        for (const Document& document : actual) {
             total_relevance += document.relevance;
         }
     }
     cout << total_relevance << endl;
 }
 
+// Scores grow by less than MERROR per word of the document, so CompareDocuments is not transitive on them.
+struct DocumentLengthRanking {
+    double ComputeWordWeight(const CorpusStatistics& corpus, const string_view& word, int document_freq) const {
+        return 1.0;
+    }
+
+    double ComputeScore(double word_weight, double term_freq, int document_length, const CorpusStatistics& corpus) const {
+        return 1.0 + document_length * 0.8 * MERROR;
+    }
+};
+
+// Checks that paging with a cursor returns every matched document exactly once.
+template <typename RankingModel = TfIdfRanking>
+void TestCursor(string_view mark, const SearchServer& search_server, const vector<string>& queries, size_t page_size,
+                RankingModel ranking_model = {}) {
+    LOG_DURATION(mark);
+    const auto is_actual = [](int document_id, DocumentStatus status, int rating) {
+        return status == DocumentStatus::ACTUAL;
+    };
+    size_t document_count = 0;
+    for (const string& query : queries) {
+        const size_t match_count = search_server.FindNextDocuments(query, is_actual, nullopt, numeric_limits<size_t>::max(),
+                                                                   ranking_model).size();
+        SearchCursor cursor(search_server, query, is_actual, page_size, ranking_model);
+        set<int> returned_ids;
+        while (cursor.HasMorePages()) {
+            for (const Document& document : cursor.NextPage()) {
+                if (!returned_ids.insert(document.id).second) {
+                    throw logic_error("cursor returned document "s + to_string(document.id) + " twice"s);
+                }
+            }
+        }
+        if (returned_ids.size() != match_count) {
+            throw logic_error("cursor returned "s + to_string(returned_ids.size()) + " of "s + to_string(match_count)
+                              + " documents"s);
+        }
+        document_count += returned_ids.size();
+    }
+    cout << document_count << endl;
+}
+
+// Throws logic_error unless the query finds exactly expected_ids, counting documents past the top ones.
+void CheckFoundIds(const SearchServer& search_server, const string& query, const set<int>& expected_ids) {
+    const auto is_any = [](int document_id, DocumentStatus status, int rating) {
+        return true;
+    };
+    set<int> found_ids;
+    for (const Document& document : search_server.FindNextDocuments(query, is_any, nullopt, numeric_limits<size_t>::max())) {
+        found_ids.insert(document.id);
+    }
+    if (found_ids != expected_ids) {
+        string ids;
+        for (const int id : found_ids) {
+            ids += ' ' + to_string(id);
+        }
+        throw logic_error("query "s + query + " found documents"s + ids);
+    }
+}
+
+// Throws logic_error unless the query is rejected with invalid_argument.
+void CheckRejected(const SearchServer& search_server, const string& query) {
+    try {
+        search_server.FindTopDocuments(query);
+    } catch (const invalid_argument&) {
+        return;
+    }
+    throw logic_error("query "s + query + " was not rejected"s);
+}
+
+// Checks phrase matching, stop-word gaps inside phrases and positions of removed documents.
+void TestPhrases(string_view mark, const SearchServer& non_positional_server) {
+    LOG_DURATION(mark);
+    SearchServer search_server("in the on"s, true);
+    search_server.AddDocument(1, "cat in the hat"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2, "cat hat"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(3, "the cat in the hat sat on the mat"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(4, "hat in the cat"s, DocumentStatus::ACTUAL, { 1 });
+    CheckFoundIds(search_server, "\"cat in the hat\""s, { 1, 3 });
+    CheckFoundIds(search_server, "\"cat hat\""s, { 2 });
+    CheckFoundIds(search_server, "\"hat sat on the mat\""s, { 3 });
+    CheckFoundIds(search_server, "\"cat in the hat\" -sat"s, { 1 });
+    CheckFoundIds(search_server, "\"cat in the hat\" \"sat on the mat\""s, { 3 });
+    CheckFoundIds(search_server, "\"in the\" cat"s, { 1, 2, 3, 4 });
+    CheckRejected(search_server, "\"cat hat"s);
+    CheckRejected(non_positional_server, "\"cat hat\""s);
+    search_server.RemoveDocument(1);
+    CheckFoundIds(search_server, "\"cat in the hat\""s, { 3 });
+    search_server.AddDocument(1, "hat cat"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(5, "a cat in the hat"s, DocumentStatus::ACTUAL, { 1 });
+    CheckFoundIds(search_server, "\"cat in the hat\""s, { 3, 5 });
+    CheckFoundIds(search_server, "\"hat cat\""s, { 1 });
+    cout << search_server.GetDocumentCount() << endl;
+}
+
+// Checks that a prefix finds every document with a matching word under MAX_PREFIX_EXPANSION
+// and that a minus-prefix excludes documents past it.
+void TestPrefixes(string_view mark) {
+    LOG_DURATION(mark);
+    SearchServer search_server(""s);
+    const int prefixed_count = MAX_PREFIX_EXPANSION + 6;
+    for (int i = 0; i < prefixed_count; ++i) {
+        const string number = to_string(i);
+        search_server.AddDocument(i, "xw"s + string(3 - number.size(), '0') + number + " common"s, DocumentStatus::ACTUAL, { 1 });
+    }
+    search_server.AddDocument(prefixed_count, "other common"s, DocumentStatus::ACTUAL, { 1 });
+    CheckFoundIds(search_server, "xw00*"s, { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+    CheckFoundIds(search_server, "common -xw*"s, { prefixed_count });
+    CheckFoundIds(search_server, "xw* -xw0*"s, {});
+    CheckFoundIds(search_server, "yz*"s, {});
+    cout << search_server.GetDocumentCount() << endl;
+}
+
+// Checks that a one-edit typo finds the document at FUZZY_DISTANCE_PENALTY of the exact relevance
+// and that words shorter than 3 characters are not expanded.
+void TestFuzzy(string_view mark) {
+    LOG_DURATION(mark);
+    SearchServer search_server(""s);
+    search_server.AddDocument(1, "kitten"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2, "sitting"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(3, "ab"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(4, "ac"s, DocumentStatus::ACTUAL, { 1 });
+    CheckFoundIds(search_server, "kittan"s, {});
+    search_server.SetFuzzyDistance(1);
+    CheckFoundIds(search_server, "kittan"s, { 1 });
+    CheckFoundIds(search_server, "sittin"s, { 2 });
+    CheckFoundIds(search_server, "ab"s, { 3 });
+    CheckFoundIds(search_server, "ad"s, {});
+    const double exact_relevance = search_server.FindTopDocuments("kitten"s).at(0).relevance;
+    const double typo_relevance = search_server.FindTopDocuments("kittan"s).at(0).relevance;
+    if (abs(typo_relevance - exact_relevance * FUZZY_DISTANCE_PENALTY) > MERROR) {
+        throw logic_error("typo relevance "s + to_string(typo_relevance) + " for exact relevance "s
+                          + to_string(exact_relevance));
+    }
+    cout << typo_relevance / exact_relevance << endl;
+}
+
+void TestStatistics(string_view mark, const SearchServer& search_server, int poll_count) {
+    IndexStatistics statistics;
+    {
+        LOG_DURATION(mark);
+        for (int i = 0; i < poll_count; ++i) {
+            statistics = search_server.GetIndexStatistics();
+        }
+    }
+    cout << statistics.term_count << " terms, "s << statistics.posting_count << " postings"s << endl;
+    cout << "word_to_document_freqs: "s << statistics.word_to_document_freqs.byte_count << " bytes, "s
+         << statistics.word_to_document_freqs.estimated_overhead << " bytes overhead"s << endl;
+    cout << "document_to_word_freqs: "s << statistics.document_to_word_freqs.byte_count << " bytes, "s
+         << statistics.document_to_word_freqs.estimated_overhead << " bytes overhead"s << endl;
+    cout << "documents: "s << statistics.documents.byte_count << " bytes, "s
+         << statistics.document_text_bytes << " bytes of text"s << endl;
+}
+
 #define TEST(policy) Test(#policy, search_server, queries, execution::policy)
 
 int main() {
@@ -78,4 +435,46 @@ int main() {
     const auto queries = GenerateQueries(generator, dictionary, 100, 70);
     TEST(seq);
     TEST(par);
+    Test("bm25 seq"sv, search_server, queries, execution::seq, Bm25Ranking{});
+    Test("bm25 par"sv, search_server, queries, execution::par, Bm25Ranking{});
+    TestMatch("match 50 documents"sv, search_server, queries, 50);
+    {
+        ShardedSearchServer sharded_server(4, dictionary[0]);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            sharded_server.AddDocument(int(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+        }
+        TestSharded("4 shards"sv, search_server, sharded_server, queries);
+        TestSharded("4 shards bm25"sv, search_server, sharded_server, queries, Bm25Ranking{});
+    }
+    TestCursor("cursor pages of 1000"sv, search_server, vector<string>(queries.begin(), queries.begin() + 3), 1'000);
+    {
+        SearchServer close_scores_server(""s);
+        close_scores_server.AddDocument(1, "a"s, DocumentStatus::ACTUAL, { 1 });
+        close_scores_server.AddDocument(2, "a b"s, DocumentStatus::ACTUAL, { 1 });
+        close_scores_server.AddDocument(3, "a b c"s, DocumentStatus::ACTUAL, { 1 });
+        TestCursor("cursor over close scores"sv, close_scores_server, { "a"s }, 1, DocumentLengthRanking{});
+    }
+    TestPhrases("phrases"sv, search_server);
+    TestPrefixes("prefixes"sv);
+    TestFuzzy("fuzzy words"sv);
+    TestStatistics("poll statistics 100000 times"sv, search_server, 100'000);
+
+    const auto large_dictionary = GenerateDictionary(generator, 100'000, 10);
+    const auto large_documents = GenerateQueries(generator, large_dictionary, 20'000, 10);
+    SearchServer large_server(large_dictionary[0]);
+    for (size_t i = 0; i < large_documents.size(); ++i) {
+        large_server.AddDocument(int(i), large_documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+    }
+    for (const size_t prefix_length : { 1, 2, 3 }) {
+        const auto prefix_queries = GeneratePrefixQueries(generator, large_dictionary, 1'000, 3, prefix_length);
+        Test("prefix "s + to_string(prefix_length), large_server, prefix_queries, execution::seq);
+    }
+
+    TestLoad("load tsv"sv, documents, dictionary[0]);
+    TestDurable(documents, dictionary[0]);
+    TestAdd("add with 5000 stop words"sv, documents, vector<string>(large_dictionary.begin(), large_dictionary.begin() + 5'000));
+    TestStopWordSet("stop word set"sv, vector<string>(large_dictionary.begin(), large_dictionary.begin() + 5'000), 200'000);
+
+    search_server.SetFuzzyDistance(2);
+    Test("fuzzy"sv, search_server, queries, execution::seq);
 }
\ No newline at end of file
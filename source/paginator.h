@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <iterator>
+#include <utility>
 #include <vector>
 
 template <typename Iterator>
@@ -63,4 +64,66 @@ public:
 
 private:
 	std::vector<IteratorRange<Iterator>> pages_;
-};
\ No newline at end of file
+};
+
+template <typename Cursor>
+class CursorPaginator {
+public:
+	using Page = decltype(std::declval<Cursor&>().NextPage());
+
+	class PageIterator {
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = IteratorRange<typename Page::const_iterator>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = value_type;
+
+		PageIterator() = default;
+
+		explicit PageIterator(Cursor& cursor) : cursor_(&cursor) {
+			Fetch();
+		}
+
+		value_type operator*() const {
+			return value_type(page_.cbegin(), page_.cend());
+		}
+
+		PageIterator& operator++() {
+			Fetch();
+			return *this;
+		}
+
+		bool operator==(const PageIterator& other) const {
+			return cursor_ == other.cursor_;
+		}
+
+		bool operator!=(const PageIterator& other) const {
+			return !(*this == other);
+		}
+
+	private:
+		Cursor* cursor_ = nullptr;
+		Page page_;
+
+		void Fetch() {
+			page_ = cursor_->NextPage();
+			if (page_.empty()) {
+				cursor_ = nullptr;
+			}
+		}
+	};
+
+	explicit CursorPaginator(Cursor& cursor) : cursor_(cursor) {}
+
+	PageIterator begin() const {
+		return PageIterator(cursor_);
+	}
+
+	PageIterator end() const {
+		return PageIterator();
+	}
+
+private:
+	Cursor& cursor_;
+};
@@ -0,0 +1,38 @@
+#include "position_list.h"
+
+using namespace std;
+
+void PositionList::Add(int position) {
+    uint32_t delta = static_cast<uint32_t>(position - last_position_);
+    while (delta >= 0x80) {
+        data_.push_back(static_cast<uint8_t>(delta | 0x80));
+        delta >>= 7;
+    }
+    data_.push_back(static_cast<uint8_t>(delta));
+    last_position_ = position;
+    ++count_;
+}
+
+vector<int> PositionList::Decode() const {
+    vector<int> positions;
+    positions.reserve(count_);
+    int position = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    for (const uint8_t byte : data_) {
+        delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        position += static_cast<int>(delta);
+        positions.push_back(position);
+        delta = 0;
+        shift = 0;
+    }
+    return positions;
+}
+
+size_t PositionList::size() const {
+    return count_;
+}
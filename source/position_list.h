@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Ascending positions of a word in a document, stored as varint-encoded deltas.
+class PositionList {
+public:
+    void Add(int position);
+
+    std::vector<int> Decode() const;
+
+    size_t size() const;
+
+private:
+    std::vector<uint8_t> data_;
+    int last_position_ = 0;
+    int count_ = 0;
+};
@@ -30,4 +30,27 @@ std::deque<Document> ProcessQueriesJoined(
         dq.insert(dq.end(), docs.begin(), docs.end());
     }    
     return dq;
+}
+
+std::vector<std::vector<Document>> ProcessQueries(
+    const ShardedSearchServer& search_server,
+    const std::vector<std::string>& queries) {
+    std::vector<std::vector<Document>> res(queries.size());
+    std::transform(std::execution::par,
+                  queries.begin(),
+                  queries.end(),
+                  res.begin(),
+                  [&search_server](const std::string& s) { return search_server.FindTopDocuments(s); });
+    
+    return res;
+}
+
+std::deque<Document> ProcessQueriesJoined(
+    const ShardedSearchServer& search_server,
+    const std::vector<std::string>& queries) {
+    std::deque<Document> dq;
+    for (const auto& docs : ProcessQueries(search_server, queries)) {
+        dq.insert(dq.end(), docs.begin(), docs.end());
+    }
+    return dq;
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <deque>
 
 #include "search_server.h"
+#include "sharded_search_server.h"
 
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
@@ -12,4 +13,12 @@ std::vector<std::vector<Document>> ProcessQueries(
 
 std::deque<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
+    const std::vector<std::string>& queries);
+
+std::vector<std::vector<Document>> ProcessQueries(
+    const ShardedSearchServer& search_server,
+    const std::vector<std::string>& queries);
+
+std::deque<Document> ProcessQueriesJoined(
+    const ShardedSearchServer& search_server,
     const std::vector<std::string>& queries);
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cmath>
+#include <string_view>
+
+struct CorpusStatistics {
+    int document_count = 0;
+    long long word_count = 0;
+    double average_document_length = 0.0;
+};
+
+// A ranking model scores one (word, document) pair in two steps:
+// ComputeWordWeight once per query word, ComputeScore once per posting.
+// SearchServer takes the model as a template parameter, so both calls are inlined.
+// The word is passed so that wrappers can substitute statistics gathered elsewhere.
+
+struct TfIdfRanking {
+    double ComputeWordWeight(const CorpusStatistics& corpus, const std::string_view& word, int document_freq) const {
+        return std::log(corpus.document_count * 1.0 / document_freq);
+    }
+
+    double ComputeScore(double word_weight, double term_freq, int document_length, const CorpusStatistics& corpus) const {
+        return term_freq * word_weight;
+    }
+};
+
+struct Bm25Ranking {
+    double k1 = 1.2;
+    double b = 0.75;
+
+    double ComputeWordWeight(const CorpusStatistics& corpus, const std::string_view& word, int document_freq) const {
+        return std::log(1.0 + (corpus.document_count - document_freq + 0.5) / (document_freq + 0.5));
+    }
+
+    double ComputeScore(double word_weight, double term_freq, int document_length, const CorpusStatistics& corpus) const {
+        const double word_count = term_freq * document_length;
+        const double length_norm = 1.0 - b + b * document_length / corpus.average_document_length;
+        return word_weight * word_count * (k1 + 1.0) / (word_count + k1 * length_norm);
+    }
+};
@@ -0,0 +1,286 @@
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+#include "rpc_protocol.h"
+
+using namespace std;
+
+namespace {
+
+class BodyWriter {
+public:
+    explicit BodyWriter(string& output)
+        : output_(output)
+        , frame_begin_(output.size()) {
+        WriteUint32(0);
+    }
+
+    ~BodyWriter() {
+        const uint32_t body_size = static_cast<uint32_t>(output_.size() - frame_begin_ - sizeof(uint32_t));
+        for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+            output_[frame_begin_ + i] = static_cast<char>((body_size >> (8 * i)) & 0xFF);
+        }
+    }
+
+    void WriteUint8(uint8_t value) {
+        output_.push_back(static_cast<char>(value));
+    }
+
+    void WriteUint32(uint32_t value) {
+        for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+            output_.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    void WriteInt32(int value) {
+        WriteUint32(static_cast<uint32_t>(value));
+    }
+
+    void WriteDouble(double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        WriteUint32(static_cast<uint32_t>(bits));
+        WriteUint32(static_cast<uint32_t>(bits >> 32));
+    }
+
+    void WriteString(string_view value) {
+        WriteUint32(static_cast<uint32_t>(value.size()));
+        output_.append(value.data(), value.size());
+    }
+
+private:
+    string& output_;
+    const size_t frame_begin_;
+};
+
+class BodyReader {
+public:
+    explicit BodyReader(string_view body)
+        : body_(body) {
+    }
+
+    uint8_t ReadUint8() {
+        Require(1);
+        const uint8_t value = static_cast<uint8_t>(body_[0]);
+        body_.remove_prefix(1);
+        return value;
+    }
+
+    uint32_t ReadUint32() {
+        Require(sizeof(uint32_t));
+        uint32_t value = 0;
+        for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(body_[i])) << (8 * i);
+        }
+        body_.remove_prefix(sizeof(uint32_t));
+        return value;
+    }
+
+    int ReadInt32() {
+        return static_cast<int>(ReadUint32());
+    }
+
+    double ReadDouble() {
+        const uint64_t low = ReadUint32();
+        const uint64_t high = ReadUint32();
+        const uint64_t bits = low | (high << 32);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    string_view ReadString() {
+        const uint32_t size = ReadUint32();
+        Require(size);
+        const string_view value = body_.substr(0, size);
+        body_.remove_prefix(size);
+        return value;
+    }
+
+    DocumentStatus ReadStatus() {
+        const uint8_t status = ReadUint8();
+        if (status > static_cast<uint8_t>(DocumentStatus::REMOVED)) {
+            throw invalid_argument("message contains unknown document status");
+        }
+        return static_cast<DocumentStatus>(status);
+    }
+
+    RpcOperation ReadOperation() {
+        const uint8_t operation = ReadUint8();
+        if (operation < static_cast<uint8_t>(RpcOperation::FIND) || operation > static_cast<uint8_t>(RpcOperation::REMOVE)) {
+            throw invalid_argument("message contains unknown operation");
+        }
+        return static_cast<RpcOperation>(operation);
+    }
+
+private:
+    string_view body_;
+
+    void Require(size_t size) const {
+        if (body_.size() < size) {
+            throw invalid_argument("message is truncated");
+        }
+    }
+};
+
+}  // namespace
+
+void SerializeRequest(const RpcRequest& request, string& output) {
+    BodyWriter writer(output);
+    writer.WriteUint8(static_cast<uint8_t>(request.operation));
+    writer.WriteUint32(request.request_id);
+    switch (request.operation) {
+    case RpcOperation::FIND:
+        writer.WriteUint8(static_cast<uint8_t>(request.status));
+        writer.WriteString(request.text);
+        break;
+    case RpcOperation::MATCH:
+        writer.WriteInt32(request.document_id);
+        writer.WriteString(request.text);
+        break;
+    case RpcOperation::ADD:
+        writer.WriteInt32(request.document_id);
+        writer.WriteUint8(static_cast<uint8_t>(request.status));
+        writer.WriteUint32(static_cast<uint32_t>(request.ratings.size()));
+        for (const int rating : request.ratings) {
+            writer.WriteInt32(rating);
+        }
+        writer.WriteString(request.text);
+        break;
+    case RpcOperation::REMOVE:
+        writer.WriteInt32(request.document_id);
+        break;
+    }
+}
+
+void SerializeResponse(const RpcResponse& response, string& output) {
+    BodyWriter writer(output);
+    writer.WriteUint8(static_cast<uint8_t>(response.operation));
+    writer.WriteUint32(response.request_id);
+    writer.WriteUint8(response.is_ok ? 1 : 0);
+    if (!response.is_ok) {
+        writer.WriteString(response.error);
+        return;
+    }
+    switch (response.operation) {
+    case RpcOperation::FIND:
+        writer.WriteUint32(static_cast<uint32_t>(response.documents.size()));
+        for (const Document& document : response.documents) {
+            writer.WriteInt32(document.id);
+            writer.WriteDouble(document.relevance);
+            writer.WriteInt32(document.rating);
+        }
+        break;
+    case RpcOperation::MATCH:
+        writer.WriteUint8(static_cast<uint8_t>(response.status));
+        writer.WriteUint32(static_cast<uint32_t>(response.words.size()));
+        for (const string& word : response.words) {
+            writer.WriteString(word);
+        }
+        break;
+    case RpcOperation::ADD:
+    case RpcOperation::REMOVE:
+        break;
+    }
+}
+
+RpcRequest ParseRequest(string_view body) {
+    BodyReader reader(body);
+    RpcRequest request;
+    request.operation = reader.ReadOperation();
+    request.request_id = reader.ReadUint32();
+    switch (request.operation) {
+    case RpcOperation::FIND:
+        request.status = reader.ReadStatus();
+        request.text = reader.ReadString();
+        break;
+    case RpcOperation::MATCH:
+        request.document_id = reader.ReadInt32();
+        request.text = reader.ReadString();
+        break;
+    case RpcOperation::ADD: {
+        request.document_id = reader.ReadInt32();
+        request.status = reader.ReadStatus();
+        const uint32_t rating_count = reader.ReadUint32();
+        if (rating_count > body.size() / sizeof(uint32_t)) {
+            throw invalid_argument("message is truncated");
+        }
+        request.ratings.reserve(rating_count);
+        for (uint32_t i = 0; i < rating_count; ++i) {
+            request.ratings.push_back(reader.ReadInt32());
+        }
+        request.text = reader.ReadString();
+        break;
+    }
+    case RpcOperation::REMOVE:
+        request.document_id = reader.ReadInt32();
+        break;
+    }
+    return request;
+}
+
+RpcResponse ParseResponse(string_view body) {
+    BodyReader reader(body);
+    RpcResponse response;
+    response.operation = reader.ReadOperation();
+    response.request_id = reader.ReadUint32();
+    response.is_ok = reader.ReadUint8() != 0;
+    if (!response.is_ok) {
+        response.error = reader.ReadString();
+        return response;
+    }
+    switch (response.operation) {
+    case RpcOperation::FIND: {
+        const uint32_t document_count = reader.ReadUint32();
+        for (uint32_t i = 0; i < document_count; ++i) {
+            const int id = reader.ReadInt32();
+            const double relevance = reader.ReadDouble();
+            const int rating = reader.ReadInt32();
+            response.documents.emplace_back(id, relevance, rating);
+        }
+        break;
+    }
+    case RpcOperation::MATCH: {
+        response.status = reader.ReadStatus();
+        const uint32_t word_count = reader.ReadUint32();
+        for (uint32_t i = 0; i < word_count; ++i) {
+            response.words.emplace_back(reader.ReadString());
+        }
+        break;
+    }
+    case RpcOperation::ADD:
+    case RpcOperation::REMOVE:
+        break;
+    }
+    return response;
+}
+
+size_t GetFrameSize(string_view buffer) {
+    if (buffer.size() < sizeof(uint32_t)) {
+        return 0;
+    }
+    uint32_t body_size = 0;
+    for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+        body_size |= static_cast<uint32_t>(static_cast<uint8_t>(buffer[i])) << (8 * i);
+    }
+    if (body_size > MAX_RPC_FRAME_SIZE) {
+        throw invalid_argument("frame size " + to_string(body_size) + " exceeds the limit");
+    }
+    const size_t frame_size = sizeof(uint32_t) + body_size;
+    return buffer.size() < frame_size ? 0 : frame_size;
+}
+
+string_view GetFrameBody(string_view frame) {
+    return frame.substr(sizeof(uint32_t));
+}
+
+uint16_t ParseTcpPort(string_view address) {
+    const string_view port_text = address.substr(address.rfind(':') + 1);
+    unsigned port = 0;
+    const auto [end, error] = from_chars(port_text.data(), port_text.data() + port_text.size(), port);
+    if (error != errc() || end != port_text.data() + port_text.size() || port == 0 || port > 65535) {
+        throw invalid_argument("wrong port: " + string(address));
+    }
+    return static_cast<uint16_t>(port);
+}
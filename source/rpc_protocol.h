@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+// Every message is a frame: a 32-bit body length followed by the body.
+// Request body:  operation (u8), request id (u32), operation payload.
+// Response body: operation (u8), request id (u32), is_ok (u8), payload or error text.
+// Integers are little-endian, strings are a u32 length followed by the bytes.
+
+const uint32_t MAX_RPC_FRAME_SIZE = 16 * 1024 * 1024;
+
+enum class RpcOperation : uint8_t {
+    FIND = 1,
+    MATCH = 2,
+    ADD = 3,
+    REMOVE = 4,
+};
+
+struct RpcRequest {
+    RpcOperation operation = RpcOperation::FIND;
+    uint32_t request_id = 0;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    std::string text;
+};
+
+struct RpcResponse {
+    RpcOperation operation = RpcOperation::FIND;
+    uint32_t request_id = 0;
+    bool is_ok = true;
+    std::string error;
+    std::vector<Document> documents;
+    std::vector<std::string> words;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+};
+
+void SerializeRequest(const RpcRequest& request, std::string& output);
+
+void SerializeResponse(const RpcResponse& response, std::string& output);
+
+RpcRequest ParseRequest(std::string_view body);
+
+RpcResponse ParseResponse(std::string_view body);
+
+// Returns the size of the first complete frame in buffer (header included), or 0 if it is not complete yet.
+size_t GetFrameSize(std::string_view buffer);
+
+std::string_view GetFrameBody(std::string_view frame);
+
+// Port of a "host:port" address. Throws invalid_argument unless it is a whole number from 1 to 65535.
+uint16_t ParseTcpPort(std::string_view address);
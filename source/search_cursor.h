@@ -0,0 +1,61 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "search_server.h"
+
+// Returns the results of one query page by page. Only the last returned document is kept
+// between pages, so every page costs one scoring pass plus a top-K selection.
+template <typename DocumentPredicate, typename RankingModel = TfIdfRanking>
+class SearchCursor {
+public:
+    SearchCursor(const SearchServer& search_server, std::string raw_query, DocumentPredicate document_predicate,
+                 size_t page_size, RankingModel ranking_model = {})
+        : search_server_(search_server)
+        , raw_query_(std::move(raw_query))
+        , document_predicate_(document_predicate)
+        , ranking_model_(ranking_model)
+        , page_size_(page_size) {
+        if (page_size_ == 0) {
+            throw std::invalid_argument("page size must be positive");
+        }
+    }
+
+    std::vector<Document> NextPage() {
+        if (is_exhausted_) {
+            return {};
+        }
+        auto page = search_server_.FindNextDocuments(raw_query_, document_predicate_, last_document_, page_size_, ranking_model_);
+        if (page.size() < page_size_) {
+            is_exhausted_ = true;
+        }
+        if (!page.empty()) {
+            last_document_ = page.back();
+        }
+        return page;
+    }
+
+    bool HasMorePages() const {
+        return !is_exhausted_;
+    }
+
+private:
+    const SearchServer& search_server_;
+    const std::string raw_query_;
+    DocumentPredicate document_predicate_;
+    RankingModel ranking_model_;
+    const size_t page_size_;
+    std::optional<Document> last_document_;
+    bool is_exhausted_ = false;
+};
+
+inline auto MakeSearchCursor(const SearchServer& search_server, std::string raw_query, size_t page_size,
+                             DocumentStatus status = DocumentStatus::ACTUAL) {
+    return SearchCursor(search_server, std::move(raw_query),
+                        [status](int document_id, DocumentStatus document_status, int rating) {
+                            return document_status == status;
+                        },
+                        page_size);
+}
@@ -2,30 +2,83 @@
 
 using namespace std;
 
-SearchServer::SearchServer(const string_view& stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text)) {}
+SearchServer::SearchServer(const string_view& stop_words_text, bool store_positions)
+    : SearchServer(SplitIntoWords(stop_words_text), store_positions) {}
 
-SearchServer::SearchServer(const std::string& stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text)) {}
+SearchServer::SearchServer(const std::string& stop_words_text, bool store_positions)
+    : SearchServer(SplitIntoWords(stop_words_text), store_positions) {}
+
+SearchServer::SearchServer(SearchServer&& other)
+    : stop_words_(other.stop_words_)
+    , store_positions_(other.store_positions_)
+    , counters_(exchange(other.counters_, make_unique<IndexCounters>()))
+    , word_to_document_freqs_(move(other.word_to_document_freqs_))
+    , document_to_word_freqs_(move(other.document_to_word_freqs_))
+    , document_to_word_positions_(move(other.document_to_word_positions_))
+    , documents_(move(other.documents_))
+    , documents_id_(move(other.documents_id_))
+    , total_word_count_(exchange(other.total_word_count_, 0))
+    , fuzzy_index_(move(other.fuzzy_index_)) {
+    // The emptied containers still hold allocators counting into the moved counters.
+    other.word_to_document_freqs_ = decltype(word_to_document_freqs_)(&other.counters_->word_to_document_freqs);
+    other.document_to_word_freqs_ = decltype(document_to_word_freqs_)(&other.counters_->document_to_word_freqs);
+    other.documents_ = decltype(documents_)(&other.counters_->documents);
+    other.document_to_word_positions_.clear();
+    other.documents_id_.clear();
+    if (other.fuzzy_index_) {
+        other.fuzzy_index_.emplace(other.fuzzy_index_->GetMaxDistance());
+    }
+}
 
 void SearchServer::AddDocument(int document_id, 
                                const string_view& document, 
                                DocumentStatus status,
                                const vector<int>& ratings) {
+    // Tokenizing validates the text, so it runs before the server is changed.
+    AddDocument(document_id, Tokenize(document), status, ratings);
+}
+
+void SearchServer::AddDocument(int document_id,
+                               const TokenizedDocument& document,
+                               DocumentStatus status,
+                               const vector<int>& ratings) {
     if (document_id < 0) {
         throw invalid_argument("id must be positive");
     }
     if (documents_.count(document_id)) {
         throw invalid_argument("id = " + to_string(document_id) + " is already exist");
     }
-    documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status, string(document.begin(), document.end()) });
+    const string& content = documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status,
+                                                                          string(document.text),
+                                                                          static_cast<int>(document.words.size()) })
+                                .first->second.document_content;
+    // The index keeps views into the stored copy of the text.
+    const auto to_stored = [&content, &document](const string_view& word) {
+        return string_view(content.data() + (word.data() - document.text.data()), word.size());
+    };
     documents_id_.insert(document_id);
-    const vector<string_view> words = SplitIntoWordsNoStop(string_view(documents_[document_id].document_content));
-    const double inv_word_count = 1.0 / words.size();
-    for (const string_view& word : words) {
+    ++counters_->document_count;
+    counters_->document_text_bytes += document.text.size();
+    total_word_count_ += document.words.size();
+    const double inv_word_count = 1.0 / document.words.size();
+    for (const string_view& text_word : document.words) {
+        const string_view word = to_stored(text_word);
         word_to_document_freqs_[word][document_id] += inv_word_count;
         document_to_word_freqs_[document_id][word] += inv_word_count;
     }
+    for (const auto& [word, _] : GetWordFrequencies(document_id)) {
+        const size_t posting_length = word_to_document_freqs_.at(word).size();
+        UpdatePostingLength(posting_length - 1, posting_length);
+        if (fuzzy_index_ && posting_length == 1) {
+            fuzzy_index_->AddWord(word);
+        }
+    }
+    if (store_positions_) {
+        auto& word_positions = document_to_word_positions_[document_id];
+        for (size_t i = 0; i < document.words.size(); ++i) {
+            word_positions[to_stored(document.words[i])].Add(document.positions[i]);
+        }
+    }
 }
 
 vector<Document> SearchServer::FindTopDocuments(const string_view& raw_query, DocumentStatus status) const {
@@ -43,57 +96,63 @@ int SearchServer::GetDocumentCount() const {
     return int(documents_.size());
 }
 
-SearchServer::Matches SearchServer::MatchDocument(const string_view& raw_query, int document_id) const {
-    const auto query = ParseQuery(raw_query, true);
-    vector<string_view> matched_words;
-    for (const string_view& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            return { matched_words, documents_.at(document_id).status };
-        }
+CorpusStatistics SearchServer::GetCorpusStatistics() const {
+    if (documents_.empty()) {
+        return {};
     }
-    for (const string_view& word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
-        }
+    return { GetDocumentCount(), total_word_count_, static_cast<double>(total_word_count_) / documents_.size() };
+}
+
+int SearchServer::GetDocumentFrequency(const string_view& word) const {
+    const auto it = word_to_document_freqs_.find(word);
+    return it == word_to_document_freqs_.end() ? 0 : static_cast<int>(it->second.size());
+}
+
+vector<string_view> SearchServer::GetScoredWords(const string_view& raw_query) const {
+    return ParseQuery(raw_query, true).plus_words;
+}
+
+IndexStatistics SearchServer::GetIndexStatistics() const {
+    IndexStatistics statistics;
+    statistics.document_count = counters_->document_count.load(memory_order_relaxed);
+    statistics.term_count = counters_->term_count.load(memory_order_relaxed);
+    statistics.posting_count = counters_->posting_count.load(memory_order_relaxed);
+    for (size_t i = 0; i < POSTING_HISTOGRAM_SIZE; ++i) {
+        statistics.posting_length_histogram[i] = counters_->posting_length_histogram[i].load(memory_order_relaxed);
+    }
+    statistics.word_to_document_freqs = counters_->word_to_document_freqs.GetUsage();
+    statistics.document_to_word_freqs = counters_->document_to_word_freqs.GetUsage();
+    statistics.documents = counters_->documents.GetUsage();
+    statistics.document_text_bytes = counters_->document_text_bytes.load(memory_order_relaxed);
+    return statistics;
+}
+
+void SearchServer::SetFuzzyDistance(int max_distance) {
+    if (max_distance < 0 || max_distance > MAX_FUZZY_DISTANCE) {
+        throw invalid_argument("fuzzy distance must be from 0 to " + to_string(MAX_FUZZY_DISTANCE));
+    }
+    if (max_distance == 0) {
+        fuzzy_index_.reset();
+        return;
     }
-    return { matched_words, documents_.at(document_id).status };
+    fuzzy_index_.emplace(max_distance);
+    for (const auto& [word, _] : word_to_document_freqs_) {
+        fuzzy_index_->AddWord(word);
+    }
+}
+
+SearchServer::Matches SearchServer::MatchDocument(const string_view& raw_query, int document_id) const {
+    const auto query = ParseQuery(raw_query, true);
+    Matches matches;
+    MatchQuery(query, document_id, matches);
+    return matches;
 }
 
 SearchServer::Matches SearchServer::MatchDocument(const std::execution::parallel_policy&, 
                                                   const string_view& raw_query, 
                                                   int document_id) const {
-    auto query = ParseQuery(raw_query, false);
-        
-    if ( any_of(execution::par, query.minus_words.cbegin(), query.minus_words.cend(),
-                     [this, document_id](const auto& word) { 
-                         if (word_to_document_freqs_.count(word) == 0) {
-                             return 0UL;
-                         }
-                         return static_cast<unsigned long>(word_to_document_freqs_.at(word).count(document_id));
-                     }) ) {
-        return { {}, documents_.at(document_id).status };
-    }    
-    vector<string_view> matched_words(query.plus_words.size());
-    
-    auto it = copy_if(execution::par, query.plus_words.cbegin(), query.plus_words.cend(),
-                 matched_words.begin(),
-                 [this, document_id](const auto& word) {
-                     if (word_to_document_freqs_.count(word) == 0) {
-                         return 0UL;
-                     }
-                     return static_cast<unsigned long>(word_to_document_freqs_.at(word).count(document_id));
-                 });
-    sort(execution::par, matched_words.begin(), it);
-    auto cit = unique(execution::par, matched_words.begin(), it);
-    matched_words.resize(distance(matched_words.begin(), cit));
-    
-    return { matched_words, documents_.at(document_id).status };
+    // A query has too few words to split between threads; parallel batches go through MatchDocuments.
+    return SearchServer::MatchDocument(raw_query, document_id);
 }
 
 SearchServer::Matches SearchServer::MatchDocument(const execution::sequenced_policy&, 
@@ -102,6 +161,31 @@ SearchServer::Matches SearchServer::MatchDocument(const execution::sequenced_pol
     return SearchServer::MatchDocument(raw_query, document_id);
 }
 
+void SearchServer::MatchDocuments(const string_view& raw_query, const vector<int>& document_ids, vector<Matches>& result) const {
+    MatchDocuments(execution::seq, raw_query, document_ids, result);
+}
+
+void SearchServer::MatchQuery(const Query& query, int document_id, Matches& matches) const {
+    auto& [matched_words, status] = matches;
+    matched_words.clear();
+    status = documents_.at(document_id).status;
+    const auto& word_freqs = GetWordFrequencies(document_id);
+    for (const string_view& word : query.minus_words) {
+        if (word_freqs.count(word)) {
+            return;
+        }
+    }
+    if (!IsQueryPhrasesInDocument(query, document_id)) {
+        return;
+    }
+    for (const string_view& word : query.plus_words) {
+        const auto it = word_freqs.find(word);
+        if (it != word_freqs.end()) {
+            matched_words.push_back(it->first);
+        }
+    }
+}
+
 set<int>::iterator SearchServer::begin() {
 	return documents_id_.begin();
 }
@@ -110,42 +194,72 @@ set<int>::iterator SearchServer::end() {
 	return documents_id_.end();
 }
 
-const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-	static map<string_view, double> empty_map_;
+const SearchServer::WordFrequencies& SearchServer::GetWordFrequencies(int document_id) const {
+	static WordFrequencies empty_map_;
 	if (document_to_word_freqs_.count(document_id) == 0) {
 		return empty_map_;
 	}
 	return document_to_word_freqs_.at(document_id);
 }
 
+tuple<string_view, DocumentStatus, int> SearchServer::GetDocument(int document_id) const {
+    const DocumentData& document = documents_.at(document_id);
+    return { document.document_content, document.status, document.rating };
+}
+
 void SearchServer::RemoveDocument(int document_id) {
 	if (documents_.count(document_id) == 0) {
 		throw invalid_argument("document with id = " + to_string(document_id) + " does not exist");
 	}
+	for (const auto& [word, freq] : GetWordFrequencies(document_id)) {
+		word_to_document_freqs_.at(word).erase(document_id);
+		DetachWordFromDocument(word, document_id);
+	}
+	total_word_count_ -= documents_.at(document_id).word_count;
+	counters_->document_text_bytes -= documents_.at(document_id).document_content.size();
+	--counters_->document_count;
 	documents_.erase(document_id);
 	documents_id_.erase(document_id);
-	const auto words = GetWordFrequencies(document_id);
-	for (const auto& [word, freq] : words) {
-		word_to_document_freqs_[word].erase(document_id);
-	}
 	document_to_word_freqs_.erase(document_id);
+	document_to_word_positions_.erase(document_id);
 }
 
 bool SearchServer::IsStopWord(const string_view& word) const {
-    return stop_words_.count(word) > 0;
+    return stop_words_.Contains(word);
 }
 
-vector<string_view> SearchServer::SplitIntoWordsNoStop(const string_view& text) const {
-    vector<string_view> words;
-    for (const string_view& word : SplitIntoWords(text)) {
-        if (!IsValidWord(word)) {
-            throw invalid_argument("document cannot contain characters from 0 to 31: " + static_cast<string>(word));
+template <typename WordHandler>
+void SearchServer::ForEachWordNoStop(const string_view& text, const char* text_kind, WordHandler handler) const {
+    int position = 0;
+    size_t word_begin = 0;
+    bool is_valid = true;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        if (i < text.size() && text[i] != ' ') {
+            is_valid = is_valid && !(text[i] >= '\0' && text[i] < ' ');
+            continue;
         }
-        if (!IsStopWord(word)) {
-            words.push_back(word);
+        if (i > word_begin) {
+            const string_view word = text.substr(word_begin, i - word_begin);
+            if (!is_valid) {
+                throw invalid_argument(string(text_kind) + " cannot contain characters from 0 to 31: " + static_cast<string>(word));
+            }
+            if (!IsStopWord(word)) {
+                handler(word, position);
+            }
+            ++position;
         }
+        word_begin = i + 1;
+        is_valid = true;
     }
-    return words;
+}
+
+SearchServer::TokenizedDocument SearchServer::Tokenize(const string_view& document) const {
+    TokenizedDocument result{ document, {}, {} };
+    ForEachWordNoStop(document, "document", [&result](const string_view& word, int position) {
+        result.words.push_back(word);
+        result.positions.push_back(position);
+    });
+    return result;
 }
 
 int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
@@ -159,6 +273,51 @@ int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
     return rating_sum / static_cast<int>(ratings.size());
 }
 
+void SearchServer::DetachWordFromDocument(const string_view& word, int document_id) {
+    const auto it = word_to_document_freqs_.find(word);
+    UpdatePostingLength(it->second.size() + 1, it->second.size());
+    if (it->second.empty()) {
+        if (fuzzy_index_) {
+            fuzzy_index_->RemoveWord(word);
+        }
+        word_to_document_freqs_.erase(it);
+        return;
+    }
+    // The index key may point into the text of the removed document; re-key it to a document that stays.
+    const string& content = documents_.at(document_id).document_content;
+    const less<const char*> before;
+    if (before(it->first.data(), content.data()) || !before(it->first.data(), content.data() + content.size())) {
+        return;
+    }
+    const int other_document_id = it->second.begin()->first;
+    auto node = word_to_document_freqs_.extract(it);
+    node.key() = document_to_word_freqs_.at(other_document_id).find(word)->first;
+    word_to_document_freqs_.insert(move(node));
+}
+
+void SearchServer::UpdatePostingLength(size_t old_length, size_t new_length) {
+    const auto get_bucket = [](size_t length) {
+        size_t bucket = 0;
+        while (length > 1 && bucket + 1 < POSTING_HISTOGRAM_SIZE) {
+            length /= 2;
+            ++bucket;
+        }
+        return bucket;
+    };
+    if (old_length > 0) {
+        --counters_->posting_length_histogram[get_bucket(old_length)];
+    } else {
+        ++counters_->term_count;
+    }
+    if (new_length > 0) {
+        ++counters_->posting_length_histogram[get_bucket(new_length)];
+    } else {
+        --counters_->term_count;
+    }
+    counters_->posting_count += new_length;
+    counters_->posting_count -= old_length;
+}
+
 SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) const {
     bool is_minus = false;
     if (!IsValidWord(text)) {
@@ -172,21 +331,114 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
     if (text.empty() || text[0] == '-') {
         throw invalid_argument("minus-word is wrong. There is only one way to set minus-word: '-minus_word'");
     }
-    return {text, is_minus, IsStopWord(text)};
+    if (text.back() == '*') {
+        text.remove_suffix(1);
+        if (text.empty()) {
+            throw invalid_argument("prefix-word is wrong. There is only one way to set prefix-word: 'prefix*'");
+        }
+        return {text, is_minus, false, true};
+    }
+    return {text, is_minus, IsStopWord(text), false};
 }
 
-SearchServer::Query SearchServer::ParseQuery(const string_view& text, bool flag_sort) const {
-    SearchServer::Query query;
+void SearchServer::ExpandPrefix(const string_view& prefix, size_t max_count, vector<string_view>& words) const {
+    size_t expansion_count = 0;
+    for (auto it = word_to_document_freqs_.lower_bound(prefix);
+         it != word_to_document_freqs_.end() && expansion_count < max_count;
+         ++it) {
+        if (it->first.substr(0, prefix.size()) != prefix) {
+            break;
+        }
+        words.push_back(it->first);
+        ++expansion_count;
+    }
+}
+
+void SearchServer::ExpandTypos(const string_view& word, Query& query) const {
+    const auto similar_words = fuzzy_index_->FindWords(word, MAX_FUZZY_EXPANSION, MAX_FUZZY_CANDIDATES);
+    for (const auto& [similar_word, distance] : similar_words) {
+        if (distance == 0) {
+            continue;
+        }
+        const string_view index_word = word_to_document_freqs_.find(similar_word)->first;
+        double& weight = query.word_weights[index_word];
+        weight = max(weight, pow(FUZZY_DISTANCE_PENALTY, distance));
+    }
+}
+
+double SearchServer::GetQueryWordWeight(const Query& query, const string_view& word) {
+    if (query.word_weights.empty()) {
+        return 1.0;
+    }
+    const auto it = query.word_weights.find(word);
+    return it == query.word_weights.end() ? 1.0 : it->second;
+}
+
+void SearchServer::ParseQueryWords(const string_view& text, Query& query) const {
     for (const string_view& word : SplitIntoWords(text)) {
         const SearchServer::QueryWord query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
+        if (query_word.is_prefix) {
+            // Plus-words are scored, so their expansion is limited; a minus-prefix excludes every word it matches.
+            if (query_word.is_minus) {
+                ExpandPrefix(query_word.data, numeric_limits<size_t>::max(), query.minus_words);
+            } else {
+                ExpandPrefix(query_word.data, MAX_PREFIX_EXPANSION, query.plus_words);
+            }
+        } else if (!query_word.is_stop) {
             if (query_word.is_minus) {
                 query.minus_words.push_back(query_word.data);
             } else {
                 query.plus_words.push_back(query_word.data);
+                if (fuzzy_index_) {
+                    ExpandTypos(query_word.data, query);
+                }
             }
         }
     }
+}
+
+SearchServer::Phrase SearchServer::ParsePhrase(const string_view& text, Query& query) const {
+    Phrase phrase;
+    ForEachWordNoStop(text, "query", [&phrase, &query](const string_view& word, int offset) {
+        phrase.words.push_back(word);
+        phrase.offsets.push_back(offset);
+        query.plus_words.push_back(word);
+    });
+    return phrase;
+}
+
+SearchServer::Query SearchServer::ParseQuery(const string_view& text, bool flag_sort) const {
+    SearchServer::Query query;
+    string_view rest = text;
+    while (!rest.empty()) {
+        const size_t phrase_begin = rest.find('"');
+        ParseQueryWords(rest.substr(0, phrase_begin), query);
+        if (phrase_begin == rest.npos) {
+            break;
+        }
+        const size_t phrase_end = rest.find('"', phrase_begin + 1);
+        if (phrase_end == rest.npos) {
+            throw invalid_argument("phrase is not closed: " + static_cast<string>(rest.substr(phrase_begin)));
+        }
+        if (!store_positions_) {
+            throw invalid_argument("phrase queries require a server with stored positions");
+        }
+        Phrase phrase = ParsePhrase(rest.substr(phrase_begin + 1, phrase_end - phrase_begin - 1), query);
+        if (!phrase.words.empty()) {
+            query.phrases.push_back(move(phrase));
+        }
+        rest = rest.substr(phrase_end + 1);
+    }
+    const size_t exact_word_count = query.plus_words.size();
+    for (auto it = query.word_weights.begin(); it != query.word_weights.end(); ) {
+        if (find(query.plus_words.begin(), query.plus_words.begin() + exact_word_count, it->first)
+            != query.plus_words.begin() + exact_word_count) {
+            it = query.word_weights.erase(it);
+        } else {
+            query.plus_words.push_back(it->first);
+            ++it;
+        }
+    }
     if (flag_sort) {
         sort(query.plus_words.begin(), query.plus_words.end());
         sort(query.minus_words.begin(), query.minus_words.end());
@@ -198,8 +450,77 @@ SearchServer::Query SearchServer::ParseQuery(const string_view& text, bool flag_
     return query;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const string_view& word) const {
-    return std::log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+bool SearchServer::IsPhraseInDocument(const Phrase& phrase, int document_id) const {
+    const auto document_it = document_to_word_positions_.find(document_id);
+    if (document_it == document_to_word_positions_.end()) {
+        return false;
+    }
+    const auto& word_positions = document_it->second;
+    vector<int> starts;
+    for (size_t i = 0; i < phrase.words.size(); ++i) {
+        const auto word_it = word_positions.find(phrase.words[i]);
+        if (word_it == word_positions.end()) {
+            return false;
+        }
+        const vector<int> positions = word_it->second.Decode();
+        const int offset = phrase.offsets[i];
+        if (i == 0) {
+            for (const int position : positions) {
+                if (position >= offset) {
+                    starts.push_back(position - offset);
+                }
+            }
+            continue;
+        }
+        auto position_it = positions.begin();
+        size_t kept = 0;
+        for (const int start : starts) {
+            position_it = lower_bound(position_it, positions.end(), start + offset);
+            if (position_it != positions.end() && *position_it == start + offset) {
+                starts[kept++] = start;
+            }
+        }
+        starts.resize(kept);
+        if (starts.empty()) {
+            return false;
+        }
+    }
+    return !starts.empty();
+}
+
+bool SearchServer::IsQueryPhrasesInDocument(const Query& query, int document_id) const {
+    return all_of(query.phrases.begin(), query.phrases.end(), [this, document_id](const Phrase& phrase) {
+        return IsPhraseInDocument(phrase, document_id);
+    });
+}
+
+vector<int> SearchServer::FindPhraseDocuments(const Query& query) const {
+    vector<int> result;
+    bool is_first_phrase = true;
+    for (const Phrase& phrase : query.phrases) {
+        const DocumentFrequencies* rarest_postings = nullptr;
+        for (const string_view& word : phrase.words) {
+            const auto it = word_to_document_freqs_.find(word);
+            if (it == word_to_document_freqs_.end() || it->second.empty()) {
+                return {};
+            }
+            if (rarest_postings == nullptr || it->second.size() < rarest_postings->size()) {
+                rarest_postings = &it->second;
+            }
+        }
+        vector<int> matched;
+        for (const auto& [document_id, _] : *rarest_postings) {
+            if (!is_first_phrase && !binary_search(result.begin(), result.end(), document_id)) {
+                continue;
+            }
+            if (IsPhraseInDocument(phrase, document_id)) {
+                matched.push_back(document_id);
+            }
+        }
+        result = move(matched);
+        is_first_phrase = false;
+    }
+    return result;
 }
 
 bool SearchServer::IsValidWord(const string_view& word) {
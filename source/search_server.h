@@ -10,48 +10,140 @@
 #include <utility>
 #include <execution>
 #include <optional>
+#include <tuple>
+#include <limits>
+#include <atomic>
+#include <memory>
+#include <scoped_allocator>
 
 #include "document.h"
 #include "string_processing.h"
 #include "concurrent_map.h"
+#include "position_list.h"
+#include "fuzzy_index.h"
+#include "stop_word_set.h"
+#include "ranking.h"
+#include "index_statistics.h"
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 const double MERROR = 1e-6;
 const int THREAD_COUNT = 32;
+const int MAX_PREFIX_EXPANSION = 64;
+const int MAX_FUZZY_DISTANCE = 2;
+const int MAX_FUZZY_EXPANSION = 8;
+const int MAX_FUZZY_CANDIDATES = 256;
+const double FUZZY_DISTANCE_PENALTY = 0.5;
+
+inline bool CompareDocuments(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < MERROR) {
+        if (lhs.rating != rhs.rating) {
+            return lhs.rating > rhs.rating;
+        }
+        return lhs.id < rhs.id;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+// Same order as CompareDocuments but without the MERROR tolerance, which makes that order
+// non-transitive. Resuming "strictly after the last document" needs a strict weak order.
+inline bool CompareDocumentsExactly(const Document& lhs, const Document& rhs) {
+    if (lhs.relevance != rhs.relevance) {
+        return lhs.relevance > rhs.relevance;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
 
 class SearchServer {
 public:
     using Matches = std::tuple<std::vector<std::string_view>, DocumentStatus>;
 
+    // Index containers count their memory through this allocator, see GetIndexStatistics.
+    template <typename T>
+    using Allocator = std::scoped_allocator_adaptor<CountingAllocator<T>>;
+    using WordFrequencies = std::map<std::string_view, double, std::less<std::string_view>,
+                                     Allocator<std::pair<const std::string_view, double>>>;
+
+    // Words of a document without stop words, with their positions counting stop words too.
+    // Words view into text.
+    struct TokenizedDocument {
+        std::string_view text;
+        std::vector<std::string_view> words;
+        std::vector<int> positions;
+    };
+
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words);
-    explicit SearchServer(const std::string_view& stop_words_text);    
-    explicit SearchServer(const std::string& stop_words_text);
+    explicit SearchServer(const StringContainer& stop_words, bool store_positions = false);
+    explicit SearchServer(const std::string_view& stop_words_text, bool store_positions = false);
+    explicit SearchServer(const std::string& stop_words_text, bool store_positions = false);
+
+    // The index and its counters move to the new server; the moved-from server is left empty
+    // with fresh counters and stays usable.
+    SearchServer(SearchServer&& other);
 
     void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
+    // Adds a document split by Tokenize of this server. The text is copied, so it only has to live during the call.
+    void AddDocument(int document_id, const TokenizedDocument& document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Splits and validates a document as AddDocument does, without changing the server. Reads only
+    // the stop words, so documents may be tokenized in other threads while documents are added.
+    TokenizedDocument Tokenize(const std::string_view& document) const;
 
-    template <typename DocumentPredicate, typename ExecutionPolicy>
-    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, DocumentPredicate document_predicate) const;
+    template <typename DocumentPredicate, typename ExecutionPolicy, typename RankingModel = TfIdfRanking>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                           RankingModel ranking_model = {}) const;
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, DocumentStatus status) const;
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query) const;
-    template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate) const;
+    template <typename DocumentPredicate, typename RankingModel = TfIdfRanking>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                           RankingModel ranking_model = {}) const;
     std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status) const;
     std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
 
+    // Up to count documents that follow last_document in CompareDocumentsExactly order.
+    template <typename DocumentPredicate, typename RankingModel = TfIdfRanking>
+    std::vector<Document> FindNextDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                            const std::optional<Document>& last_document, size_t count,
+                                            RankingModel ranking_model = {}) const;
+
     int GetDocumentCount() const;
 
+    CorpusStatistics GetCorpusStatistics() const;
+
+    int GetDocumentFrequency(const std::string_view& word) const;
+
+    // Index words FindTopDocuments scores for the query: plus-words with their prefix and typo expansions.
+    std::vector<std::string_view> GetScoredWords(const std::string_view& raw_query) const;
+
+    // Reads only atomic counters, so it can be polled from a monitoring thread while queries
+    // and even mutations run; the counters are then not guaranteed to agree with each other.
+    IndexStatistics GetIndexStatistics() const;
+
+    void SetFuzzyDistance(int max_distance);
+
     Matches MatchDocument(const std::string_view& raw_query, int document_id) const;
     Matches MatchDocument(const std::execution::sequenced_policy&, const std::string_view& raw_query, int document_id) const;    
     Matches MatchDocument(const std::execution::parallel_policy&, const std::string_view& raw_query, int document_id) const;
 
+    void MatchDocuments(const std::string_view& raw_query, const std::vector<int>& document_ids, std::vector<Matches>& result) const;
+
+    template <typename ExecutionPolicy>
+    void MatchDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, const std::vector<int>& document_ids,
+                        std::vector<Matches>& result) const;
+
     std::set<int>::iterator begin();
 
     std::set<int>::iterator end();
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    // Term frequencies of the document's words; an unknown id gets an empty map.
+    const WordFrequencies& GetWordFrequencies(int document_id) const;
+
+    // Text, status and average rating of a document. Throws out_of_range for an unknown id.
+    std::tuple<std::string_view, DocumentStatus, int> GetDocument(int document_id) const;
 
     void RemoveDocument(int document_id);
     
@@ -63,91 +155,159 @@ private:
         int rating;
         DocumentStatus status;
         std::string document_content;
+        int word_count;
     };
-    const std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
-    std::map<int, DocumentData> documents_;
+    struct IndexCounters {
+        AllocationCounter word_to_document_freqs;
+        AllocationCounter document_to_word_freqs;
+        AllocationCounter documents;
+        std::atomic<int> document_count;
+        std::atomic<size_t> term_count;
+        std::atomic<size_t> posting_count;
+        std::atomic<size_t> document_text_bytes;
+        std::array<std::atomic<size_t>, POSTING_HISTOGRAM_SIZE> posting_length_histogram;
+    };
+    using DocumentFrequencies = std::map<int, double, std::less<int>, Allocator<std::pair<const int, double>>>;
+
+    const StopWordSet stop_words_;
+    const bool store_positions_;
+    // Allocators of the containers below point into the counters, which move with the containers.
+    std::unique_ptr<IndexCounters> counters_ = std::make_unique<IndexCounters>();
+    std::map<std::string_view, DocumentFrequencies, std::less<std::string_view>,
+             Allocator<std::pair<const std::string_view, DocumentFrequencies>>>
+        word_to_document_freqs_{ &counters_->word_to_document_freqs };
+    std::map<int, WordFrequencies, std::less<int>, Allocator<std::pair<const int, WordFrequencies>>>
+        document_to_word_freqs_{ &counters_->document_to_word_freqs };
+    std::map<int, std::map<std::string_view, PositionList>> document_to_word_positions_;
+    std::map<int, DocumentData, std::less<int>, CountingAllocator<std::pair<const int, DocumentData>>>
+        documents_{ &counters_->documents };
     std::set<int> documents_id_;
+    long long total_word_count_ = 0;
+    std::optional<FuzzyIndex> fuzzy_index_;
 
     bool IsStopWord(const std::string_view& word) const;
 
-    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view& text) const;
+    // Splits text into words and drops stop words in one pass. handler(word, position) gets
+    // every other word, position counts stop words too.
+    template <typename WordHandler>
+    void ForEachWordNoStop(const std::string_view& text, const char* text_kind, WordHandler handler) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
+    void DetachWordFromDocument(const std::string_view& word, int document_id);
+
+    void UpdatePostingLength(size_t old_length, size_t new_length);
+
     struct QueryWord {
         std::string_view data;
         bool is_minus;
         bool is_stop;
+        bool is_prefix;
     };
 
     QueryWord ParseQueryWord(std::string_view text) const;
 
+    // Appends index words starting with prefix, at most max_count of them.
+    void ExpandPrefix(const std::string_view& prefix, size_t max_count, std::vector<std::string_view>& words) const;
+
+    struct Phrase {
+        std::vector<std::string_view> words;
+        std::vector<int> offsets;
+    };
+
     struct Query {
         std::vector<std::string_view> plus_words;
         std::vector<std::string_view> minus_words;
+        std::vector<Phrase> phrases;
+        std::map<std::string_view, double> word_weights;
     };
 
+    void ExpandTypos(const std::string_view& word, Query& query) const;
+
+    static double GetQueryWordWeight(const Query& query, const std::string_view& word);
+
+    void ParseQueryWords(const std::string_view& text, Query& query) const;
+
+    Phrase ParsePhrase(const std::string_view& text, Query& query) const;
+
     Query ParseQuery(const std::string_view& text, bool flag_sort) const;
 
-    double ComputeWordInverseDocumentFreq(const std::string_view& word) const;
+    bool IsPhraseInDocument(const Phrase& phrase, int document_id) const;
+
+    bool IsQueryPhrasesInDocument(const Query& query, int document_id) const;
+
+    std::vector<int> FindPhraseDocuments(const Query& query) const;
 
-    template <typename DocumentPredicate>
+    void MatchQuery(const Query& query, int document_id, Matches& matches) const;
+
+    template <typename DocumentPredicate, typename RankingModel>
     std::vector<Document> FindAllDocuments(const std::optional<Query>& query,
-                                           DocumentPredicate document_predicate) const;
-    template <typename DocumentPredicate, typename ExecutionPolicy>
+                                           DocumentPredicate document_predicate,
+                                           const RankingModel& ranking_model) const;
+    template <typename DocumentPredicate, typename ExecutionPolicy, typename RankingModel>
     std::vector<Document> FindAllDocuments(ExecutionPolicy&& policy, const std::optional<Query>& query,
-                                           DocumentPredicate document_predicate) const;
+                                           DocumentPredicate document_predicate,
+                                           const RankingModel& ranking_model) const;
 
     static bool IsValidWord(const std::string_view& word);
 };
 
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words)
-	: stop_words_(MakeUniqueNonEmptyStrings(stop_words)) {
+SearchServer::SearchServer(const StringContainer& stop_words, bool store_positions)
+	: stop_words_(MakeUniqueNonEmptyStrings(stop_words))
+	, store_positions_(store_positions) {
 	if (!all_of(stop_words.begin(), stop_words.end(), IsValidWord)) {
 		throw std::invalid_argument("stop-word cannot contain characters from 0 to 31");
 	}
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate) const {
+template <typename DocumentPredicate, typename RankingModel>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                                     RankingModel ranking_model) const {
     const auto query = ParseQuery(raw_query, true);
-    auto matched_documents = FindAllDocuments(query, document_predicate);
-    std::sort(matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < MERROR) {
-                return lhs.rating > rhs.rating;
-            }
-            else {
-                return lhs.relevance > rhs.relevance;
-            }
-        });
+    auto matched_documents = FindAllDocuments(query, document_predicate, ranking_model);
+    std::sort(matched_documents.begin(), matched_documents.end(), CompareDocuments);
     if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
         matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
     }
     return matched_documents;
 }
 
-template <typename DocumentPredicate, typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, DocumentPredicate document_predicate) const {
+template <typename DocumentPredicate, typename ExecutionPolicy, typename RankingModel>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                                     RankingModel ranking_model) const {
 	const auto query = ParseQuery(raw_query, true);
-	auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-	std::sort(policy, matched_documents.begin(), matched_documents.end(),
-		 [](const Document& lhs, const Document& rhs) {
-			 if (std::abs(lhs.relevance - rhs.relevance) < MERROR) {
-				 return lhs.rating > rhs.rating;
-			 } else {
-				 return lhs.relevance > rhs.relevance;
-			 }
-		 });
+	auto matched_documents = FindAllDocuments(policy, query, document_predicate, ranking_model);
+	std::sort(policy, matched_documents.begin(), matched_documents.end(), CompareDocuments);
 	if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
 		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
 	}
 	return matched_documents;
 }
 
+template <typename DocumentPredicate, typename RankingModel>
+std::vector<Document> SearchServer::FindNextDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                                      const std::optional<Document>& last_document, size_t count,
+                                                      RankingModel ranking_model) const {
+    const auto query = ParseQuery(raw_query, true);
+    auto matched_documents = FindAllDocuments(query, document_predicate, ranking_model);
+    if (last_document) {
+        auto it = std::remove_if(matched_documents.begin(), matched_documents.end(),
+                                 [&last_document](const Document& document) {
+                                     return !CompareDocumentsExactly(*last_document, document);
+                                 });
+        matched_documents.erase(it, matched_documents.end());
+    }
+    if (matched_documents.size() > count) {
+        std::partial_sort(matched_documents.begin(), matched_documents.begin() + count, matched_documents.end(),
+                          CompareDocumentsExactly);
+        matched_documents.resize(count);
+    } else {
+        std::sort(matched_documents.begin(), matched_documents.end(), CompareDocumentsExactly);
+    }
+    return matched_documents;
+}
+
 template <typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, DocumentStatus status) const {
     return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
@@ -160,21 +320,25 @@ std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, c
     return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
 }
 
-template <typename DocumentPredicate>
+template <typename DocumentPredicate, typename RankingModel>
 std::vector<Document> SearchServer::FindAllDocuments(const std::optional<Query>& query,
-    DocumentPredicate document_predicate) const {
+    DocumentPredicate document_predicate, const RankingModel& ranking_model) const {
     std::map<int, double> document_to_relevance;
+    const CorpusStatistics corpus = GetCorpusStatistics();
 
     for (const std::string_view& word : query->plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+        const auto postings_it = word_to_document_freqs_.find(word);
+        if (postings_it == word_to_document_freqs_.end()) {
             continue;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+        const auto& postings = postings_it->second;
+        const double word_weight = ranking_model.ComputeWordWeight(corpus, word, static_cast<int>(postings.size()))
+                                   * GetQueryWordWeight(*query, word);
 
-        for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(word)) {
+        for (const auto& [document_id, term_freq] : postings) {
             const auto& document_data = documents_.at(document_id);
             if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+                document_to_relevance[document_id] += ranking_model.ComputeScore(word_weight, term_freq, document_data.word_count, corpus);
             }
         }
     }
@@ -187,26 +351,39 @@ std::vector<Document> SearchServer::FindAllDocuments(const std::optional<Query>&
             document_to_relevance.erase(document_id);
         }
     }
+    std::vector<int> phrase_documents;
+    if (!query->phrases.empty()) {
+        phrase_documents = FindPhraseDocuments(*query);
+    }
     std::vector<Document> matched_documents;
     for (const auto& [document_id, relevance] : document_to_relevance) {
+        if (!query->phrases.empty()
+            && !std::binary_search(phrase_documents.begin(), phrase_documents.end(), document_id)) {
+            continue;
+        }
         matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
     }
     return matched_documents;
 }
 
-template <typename DocumentPredicate, typename ExecutionPolicy>
+template <typename DocumentPredicate, typename ExecutionPolicy, typename RankingModel>
 std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& policy, const std::optional<Query>& query,
-                                       DocumentPredicate document_predicate) const {
+                                       DocumentPredicate document_predicate, const RankingModel& ranking_model) const {
     ConcurrentMap<int, double> document_to_relevance(THREAD_COUNT);
+    const CorpusStatistics corpus = GetCorpusStatistics();
 
-    std::for_each(policy, query->plus_words.cbegin(), query->plus_words.end(), [this, document_predicate, &document_to_relevance](const std::string_view& word){
-        if (word_to_document_freqs_.count(word) != 0) {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+    std::for_each(policy, query->plus_words.cbegin(), query->plus_words.end(),
+                  [this, &query, &corpus, &ranking_model, document_predicate, &document_to_relevance](const std::string_view& word){
+        const auto postings_it = word_to_document_freqs_.find(word);
+        if (postings_it != word_to_document_freqs_.end()) {
+            const auto& postings = postings_it->second;
+            const double word_weight = ranking_model.ComputeWordWeight(corpus, word, static_cast<int>(postings.size()))
+                                       * GetQueryWordWeight(*query, word);
 
-            for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(word)) {
+            for (const auto& [document_id, term_freq] : postings) {
                 const auto& document_data = documents_.at(document_id);
                 if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
+                    document_to_relevance[document_id].ref_to_value += ranking_model.ComputeScore(word_weight, term_freq, document_data.word_count, corpus);
                 }
             }
         }
@@ -218,31 +395,63 @@ std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& policy, c
             }
         }
     });
+    std::vector<int> phrase_documents;
+    if (!query->phrases.empty()) {
+        phrase_documents = FindPhraseDocuments(*query);
+    }
     std::vector<Document> matched_documents;
     std::map<int, double> document_to_relevance_ordinary = document_to_relevance.BuildOrdinaryMap();
     for (const auto& [document_id, relevance] : document_to_relevance_ordinary) {
+        if (!query->phrases.empty()
+            && !std::binary_search(phrase_documents.begin(), phrase_documents.end(), document_id)) {
+            continue;
+        }
         matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
     }
     return matched_documents;
 }
 
+template <typename ExecutionPolicy>
+void SearchServer::MatchDocuments(ExecutionPolicy&& policy, const std::string_view& raw_query, const std::vector<int>& document_ids,
+                                  std::vector<Matches>& result) const {
+    for (const int document_id : document_ids) {
+        if (documents_.count(document_id) == 0) {
+            throw std::invalid_argument("document with id = " + std::to_string(document_id) + " does not exist");
+        }
+    }
+    const auto query = ParseQuery(raw_query, true);
+    result.resize(document_ids.size());
+    std::vector<size_t> indexes(document_ids.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(policy, indexes.begin(), indexes.end(), [this, &query, &document_ids, &result](size_t index) {
+        MatchQuery(query, document_ids[index], result[index]);
+    });
+}
+
 template <typename ExecutionPolicy>
 void SearchServer::RemoveDocument(ExecutionPolicy&& policy, int document_id) {
 	if (documents_.count(document_id) == 0) {
 		throw std::invalid_argument("document with id = " + std::to_string(document_id) + " does not exist");
 	}
-	documents_.erase(document_id);
-	documents_id_.erase(document_id);
-    
-    std::vector<std::string_view> tmp(document_to_word_freqs_.at(document_id).size());
+    const auto& word_freqs = GetWordFrequencies(document_id);
+    std::vector<std::string_view> tmp(word_freqs.size());
     std::transform(policy, 
-                   document_to_word_freqs_.at(document_id).cbegin(),
-                   document_to_word_freqs_.at(document_id).cend(),
+                   word_freqs.cbegin(),
+                   word_freqs.cend(),
                    tmp.begin(),
                    [](const auto& item) { return item.first; } );
     
 	std::for_each(policy, tmp.begin(), tmp.end(),
-              [this, document_id](const std::string_view& item) { word_to_document_freqs_[item].erase(document_id); });
-    
+              [this, document_id](const std::string_view& item) { word_to_document_freqs_.at(item).erase(document_id); });
+	for (const std::string_view& word : tmp) {
+		DetachWordFromDocument(word, document_id);
+	}
+
+	total_word_count_ -= documents_.at(document_id).word_count;
+	counters_->document_text_bytes -= documents_.at(document_id).document_content.size();
+	--counters_->document_count;
+	documents_.erase(document_id);
+	documents_id_.erase(document_id);
 	document_to_word_freqs_.erase(document_id);
+	document_to_word_positions_.erase(document_id);
 }
@@ -0,0 +1,352 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <execution>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "search_service.h"
+
+using namespace std;
+
+namespace {
+
+const int MAX_EPOLL_EVENTS = 256;
+const size_t READ_CHUNK_SIZE = 64 * 1024;
+
+void ThrowSystemError(const string& action) {
+    throw runtime_error(action + ": " + strerror(errno));
+}
+
+void SetNonBlocking(int fd) {
+    const int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        ThrowSystemError("fcntl");
+    }
+}
+
+bool IsReadOnly(RpcOperation operation) {
+    return operation == RpcOperation::FIND || operation == RpcOperation::MATCH;
+}
+
+}  // namespace
+
+SearchService::SearchService(SearchServer& search_server)
+    : search_server_(search_server) {
+    epoll_fd_ = epoll_create1(0);
+    if (epoll_fd_ < 0) {
+        ThrowSystemError("epoll_create1");
+    }
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK);
+    if (wakeup_fd_ < 0) {
+        ThrowSystemError("eventfd");
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wakeup_fd_;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &event) < 0) {
+        ThrowSystemError("epoll_ctl");
+    }
+}
+
+SearchService::~SearchService() {
+    for (const auto& [fd, _] : connections_) {
+        close(fd);
+    }
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+    }
+    if (!unix_socket_path_.empty()) {
+        unlink(unix_socket_path_.c_str());
+    }
+    close(wakeup_fd_);
+    close(epoll_fd_);
+}
+
+void SearchService::Listen(const string& address) {
+    if (listen_fd_ >= 0) {
+        throw logic_error("service is already listening");
+    }
+    const size_t colon = address.rfind(':');
+    if (colon != string::npos && address.find('/') == string::npos) {
+        sockaddr_in socket_address{};
+        socket_address.sin_family = AF_INET;
+        socket_address.sin_port = htons(ParseTcpPort(address));
+        if (inet_pton(AF_INET, address.substr(0, colon).c_str(), &socket_address.sin_addr) != 1) {
+            throw invalid_argument("wrong address: " + address);
+        }
+        if ((ntohl(socket_address.sin_addr.s_addr) >> 24) != 127) {
+            throw invalid_argument("only loopback addresses 127.0.0.0/8 are allowed: " + address);
+        }
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_fd_ < 0) {
+            ThrowSystemError("socket");
+        }
+        const int enable = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&socket_address), sizeof(socket_address)) < 0) {
+            ThrowSystemError("bind " + address);
+        }
+    } else {
+        sockaddr_un socket_address{};
+        socket_address.sun_family = AF_UNIX;
+        if (address.size() >= sizeof(socket_address.sun_path)) {
+            throw invalid_argument("socket path is too long: " + address);
+        }
+        strcpy(socket_address.sun_path, address.c_str());
+        listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd_ < 0) {
+            ThrowSystemError("socket");
+        }
+        unlink(address.c_str());
+        if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&socket_address), sizeof(socket_address)) < 0) {
+            ThrowSystemError("bind " + address);
+        }
+        unix_socket_path_ = address;
+    }
+    if (listen(listen_fd_, SOMAXCONN) < 0) {
+        ThrowSystemError("listen");
+    }
+    SetNonBlocking(listen_fd_);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listen_fd_;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event) < 0) {
+        ThrowSystemError("epoll_ctl");
+    }
+}
+
+void SearchService::Run() {
+    if (listen_fd_ < 0) {
+        throw logic_error("service is not listening");
+    }
+    vector<epoll_event> events(MAX_EPOLL_EVENTS);
+    vector<PendingRequest> pending;
+    while (!is_stopped_) {
+        const int event_count = epoll_wait(epoll_fd_, events.data(), MAX_EPOLL_EVENTS, -1);
+        if (event_count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("epoll_wait");
+        }
+        pending.clear();
+        for (int i = 0; i < event_count; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == wakeup_fd_) {
+                continue;
+            }
+            if (fd == listen_fd_) {
+                AcceptConnections();
+                continue;
+            }
+            const auto it = connections_.find(fd);
+            if (it == connections_.end()) {
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                ReadConnection(fd, it->second, pending);
+            }
+            if (events[i].events & EPOLLOUT) {
+                FlushConnection(fd, it->second);
+            }
+        }
+        ExecuteRequests(pending);
+        for (auto it = connections_.begin(); it != connections_.end(); ) {
+            const int fd = it->first;
+            ++it;
+            FlushConnection(fd, connections_.at(fd));
+        }
+    }
+}
+
+void SearchService::Stop() {
+    is_stopped_ = true;
+    const uint64_t value = 1;
+    [[maybe_unused]] const ssize_t written = write(wakeup_fd_, &value, sizeof(value));
+}
+
+void SearchService::AcceptConnections() {
+    while (true) {
+        const int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                return;
+            }
+            ThrowSystemError("accept");
+        }
+        SetNonBlocking(fd);
+        const int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            ThrowSystemError("epoll_ctl");
+        }
+        Connection& connection = connections_[fd];
+        connection.id = next_connection_id_++;
+        connection.events = EPOLLIN;
+    }
+}
+
+void SearchService::ReadConnection(int fd, Connection& connection, vector<PendingRequest>& pending) {
+    char buffer[READ_CHUNK_SIZE];
+    while (true) {
+        const ssize_t read_size = read(fd, buffer, sizeof(buffer));
+        if (read_size > 0) {
+            connection.input.append(buffer, read_size);
+            // The rest is read on the next iteration, after the complete frames are executed.
+            if (connection.input.size() > MAX_RPC_FRAME_SIZE) {
+                break;
+            }
+            continue;
+        }
+        if (read_size < 0 && errno == EINTR) {
+            continue;
+        }
+        if (read_size == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            connection.is_closing = true;
+        }
+        break;
+    }
+    size_t offset = 0;
+    try {
+        while (true) {
+            const string_view rest = string_view(connection.input).substr(offset);
+            const size_t frame_size = GetFrameSize(rest);
+            if (frame_size == 0) {
+                break;
+            }
+            pending.push_back({ fd, connection.id, ParseRequest(GetFrameBody(rest.substr(0, frame_size))) });
+            offset += frame_size;
+        }
+    } catch (const invalid_argument&) {
+        connection.input.clear();
+        connection.is_closing = true;
+        return;
+    }
+    connection.input.erase(0, offset);
+}
+
+void SearchService::FlushConnection(int fd, Connection& connection) {
+    while (!connection.output.empty()) {
+        const ssize_t written = send(fd, connection.output.data(), connection.output.size(), MSG_NOSIGNAL);
+        if (written > 0) {
+            connection.output.erase(0, written);
+            continue;
+        }
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        CloseConnection(fd);
+        return;
+    }
+    if (connection.output.empty() && connection.is_closing) {
+        CloseConnection(fd);
+        return;
+    }
+    // A client that pipelines requests but does not read the responses is not read either.
+    uint32_t events = 0;
+    // A half-closed client stays readable at EOF, so it is only waited on for writing.
+    if (!connection.is_closing && connection.output.size() < MAX_CONNECTION_OUTPUT_SIZE) {
+        events |= EPOLLIN;
+    }
+    if (!connection.output.empty()) {
+        events |= EPOLLOUT;
+    }
+    if (events != connection.events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event);
+        connection.events = events;
+    }
+}
+
+void SearchService::CloseConnection(int fd) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections_.erase(fd);
+}
+
+void SearchService::ExecuteRequests(const vector<PendingRequest>& pending) {
+    vector<RpcResponse> responses;
+    for (auto batch_begin = pending.begin(); batch_begin != pending.end(); ) {
+        if (!IsReadOnly(batch_begin->request.operation)) {
+            Respond(*batch_begin, ExecuteMutation(batch_begin->request));
+            ++batch_begin;
+            continue;
+        }
+        auto batch_end = find_if(batch_begin, pending.end(), [](const PendingRequest& request) {
+            return !IsReadOnly(request.request.operation);
+        });
+        if (static_cast<size_t>(batch_end - batch_begin) > MAX_RPC_BATCH_SIZE) {
+            batch_end = batch_begin + MAX_RPC_BATCH_SIZE;
+        }
+        responses.resize(batch_end - batch_begin);
+        transform(execution::par, batch_begin, batch_end, responses.begin(),
+                  [this](const PendingRequest& request) { return ExecuteQuery(request.request); });
+        for (size_t i = 0; i < responses.size(); ++i) {
+            Respond(batch_begin[i], responses[i]);
+        }
+        batch_begin = batch_end;
+    }
+}
+
+RpcResponse SearchService::ExecuteQuery(const RpcRequest& request) const {
+    RpcResponse response;
+    response.operation = request.operation;
+    response.request_id = request.request_id;
+    try {
+        if (request.operation == RpcOperation::FIND) {
+            response.documents = search_server_.FindTopDocuments(request.text, request.status);
+        } else {
+            const auto [words, status] = search_server_.MatchDocument(request.text, request.document_id);
+            response.words.assign(words.begin(), words.end());
+            response.status = status;
+        }
+    } catch (const exception& e) {
+        response.is_ok = false;
+        response.error = e.what();
+    }
+    return response;
+}
+
+RpcResponse SearchService::ExecuteMutation(const RpcRequest& request) {
+    RpcResponse response;
+    response.operation = request.operation;
+    response.request_id = request.request_id;
+    try {
+        if (request.operation == RpcOperation::ADD) {
+            search_server_.AddDocument(request.document_id, request.text, request.status, request.ratings);
+        } else {
+            search_server_.RemoveDocument(request.document_id);
+        }
+    } catch (const exception& e) {
+        response.is_ok = false;
+        response.error = e.what();
+    }
+    return response;
+}
+
+void SearchService::Respond(const PendingRequest& pending, const RpcResponse& response) {
+    const auto it = connections_.find(pending.fd);
+    if (it == connections_.end() || it->second.id != pending.connection_id) {
+        return;
+    }
+    SerializeResponse(response, it->second.output);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "rpc_protocol.h"
+#include "search_server.h"
+
+const size_t MAX_RPC_BATCH_SIZE = 256;
+// A connection is not read while this many response bytes wait to be sent to it.
+const size_t MAX_CONNECTION_OUTPUT_SIZE = 4 * 1024 * 1024;
+
+// Serves SearchServer over a Unix-domain or loopback TCP socket (see rpc_protocol.h).
+// One thread runs an epoll loop. Clients may pipeline requests. Queries that arrive
+// together, from any connection, are executed as one parallel batch, while
+// additions and removals run alone, in arrival order between the batches.
+class SearchService {
+public:
+    explicit SearchService(SearchServer& search_server);
+
+    ~SearchService();
+
+    // A path for a Unix-domain socket or "127.x.x.x:port" for TCP. The protocol has no
+    // authentication, so other addresses are rejected with invalid_argument.
+    void Listen(const std::string& address);
+
+    void Run();
+
+    // Can be called from another thread or a signal handler.
+    void Stop();
+
+private:
+    struct Connection {
+        uint64_t id = 0;
+        std::string input;
+        std::string output;
+        bool is_closing = false;
+        // Events the connection is registered for in epoll.
+        uint32_t events = 0;
+    };
+
+    struct PendingRequest {
+        int fd;
+        uint64_t connection_id;
+        RpcRequest request;
+    };
+
+    SearchServer& search_server_;
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int wakeup_fd_ = -1;
+    std::string unix_socket_path_;
+    std::atomic<bool> is_stopped_ = false;
+    std::map<int, Connection> connections_;
+    uint64_t next_connection_id_ = 1;
+
+    void AcceptConnections();
+
+    void ReadConnection(int fd, Connection& connection, std::vector<PendingRequest>& pending);
+
+    void FlushConnection(int fd, Connection& connection);
+
+    void CloseConnection(int fd);
+
+    void ExecuteRequests(const std::vector<PendingRequest>& pending);
+
+    RpcResponse ExecuteQuery(const RpcRequest& request) const;
+
+    RpcResponse ExecuteMutation(const RpcRequest& request);
+
+    void Respond(const PendingRequest& pending, const RpcResponse& response);
+};
@@ -0,0 +1,100 @@
+#include "sharded_search_server.h"
+
+using namespace std;
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const string_view& stop_words_text, bool store_positions)
+    : ShardedSearchServer(shard_count, SplitIntoWords(stop_words_text), store_positions) {}
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const string& stop_words_text, bool store_positions)
+    : ShardedSearchServer(shard_count, SplitIntoWords(stop_words_text), store_positions) {}
+
+void ShardedSearchServer::AddDocument(int document_id,
+                                      const string_view& document,
+                                      DocumentStatus status,
+                                      const vector<int>& ratings) {
+    GetDocumentShard(document_id).AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    GetDocumentShard(document_id).RemoveDocument(document_id);
+}
+
+void ShardedSearchServer::SetFuzzyDistance(int max_distance) {
+    for (SearchServer& shard : shards_) {
+        shard.SetFuzzyDistance(max_distance);
+    }
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(const string_view& raw_query, DocumentStatus status) const {
+    return FindTopDocuments(
+        raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        });
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(const string_view& raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+SearchServer::Matches ShardedSearchServer::MatchDocument(const string_view& raw_query, int document_id) const {
+    return shards_[GetShardIndex(document_id)].MatchDocument(raw_query, document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    int document_count = 0;
+    for (const SearchServer& shard : shards_) {
+        document_count += shard.GetDocumentCount();
+    }
+    return document_count;
+}
+
+CorpusStatistics ShardedSearchServer::GetCorpusStatistics() const {
+    CorpusStatistics corpus;
+    for (const SearchServer& shard : shards_) {
+        const CorpusStatistics shard_corpus = shard.GetCorpusStatistics();
+        corpus.document_count += shard_corpus.document_count;
+        corpus.word_count += shard_corpus.word_count;
+    }
+    if (corpus.document_count > 0) {
+        corpus.average_document_length = static_cast<double>(corpus.word_count) / corpus.document_count;
+    }
+    return corpus;
+}
+
+int ShardedSearchServer::GetDocumentFrequency(const string_view& word) const {
+    int document_freq = 0;
+    for (const SearchServer& shard : shards_) {
+        document_freq += shard.GetDocumentFrequency(word);
+    }
+    return document_freq;
+}
+
+map<string, int, less<>> ShardedSearchServer::GetDocumentFrequencies(const string_view& raw_query) const {
+    map<string, int, less<>> document_freqs;
+    for (const SearchServer& shard : shards_) {
+        for (const string_view& word : shard.GetScoredWords(raw_query)) {
+            document_freqs.emplace(word, 0);
+        }
+    }
+    for (auto& [word, document_freq] : document_freqs) {
+        document_freq = GetDocumentFrequency(word);
+    }
+    return document_freqs;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+    const uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(document_id)) * 0x9E3779B97F4A7C15ULL;
+    return (hash >> 32) % shards_.size();
+}
+
+const SearchServer& ShardedSearchServer::GetShard(size_t shard_index) const {
+    return shards_.at(shard_index);
+}
+
+SearchServer& ShardedSearchServer::GetDocumentShard(int document_id) {
+    return shards_[GetShardIndex(document_id)];
+}
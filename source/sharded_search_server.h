@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <execution>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "search_server.h"
+
+// Splits documents by id hash across independent SearchServer shards.
+// Queries fan out to all shards with collection statistics of the whole
+// corpus, so the merged top is the same as that of a single server.
+// Prefix and typo expansions are capped per shard, so a capped expansion
+// may choose other words than a single server would.
+class ShardedSearchServer {
+public:
+    template <typename StringContainer>
+    ShardedSearchServer(size_t shard_count, const StringContainer& stop_words, bool store_positions = false);
+    ShardedSearchServer(size_t shard_count, const std::string_view& stop_words_text, bool store_positions = false);
+    ShardedSearchServer(size_t shard_count, const std::string& stop_words_text, bool store_positions = false);
+
+    void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    void SetFuzzyDistance(int max_distance);
+
+    template <typename DocumentPredicate, typename RankingModel = TfIdfRanking>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                           RankingModel ranking_model = {}) const;
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
+
+    SearchServer::Matches MatchDocument(const std::string_view& raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+
+    CorpusStatistics GetCorpusStatistics() const;
+
+    int GetDocumentFrequency(const std::string_view& word) const;
+
+    // Corpus-wide document frequencies of every word that some shard scores for the query.
+    std::map<std::string, int, std::less<>> GetDocumentFrequencies(const std::string_view& raw_query) const;
+
+    size_t GetShardCount() const;
+
+    size_t GetShardIndex(int document_id) const;
+
+    const SearchServer& GetShard(size_t shard_index) const;
+
+private:
+    std::vector<SearchServer> shards_;
+
+    SearchServer& GetDocumentShard(int document_id);
+};
+
+// Replaces the statistics of a single shard with those of the whole sharded server.
+template <typename RankingModel>
+class ShardedRanking {
+public:
+    ShardedRanking(RankingModel ranking_model, const CorpusStatistics& corpus,
+                   std::map<std::string, int, std::less<>> document_freqs)
+        : ranking_model_(ranking_model)
+        , corpus_(corpus)
+        , document_freqs_(std::move(document_freqs)) {
+    }
+
+    double ComputeWordWeight(const CorpusStatistics& corpus, const std::string_view& word, int document_freq) const {
+        const auto it = document_freqs_.find(word);
+        return ranking_model_.ComputeWordWeight(corpus_, word, it == document_freqs_.end() ? document_freq : it->second);
+    }
+
+    double ComputeScore(double word_weight, double term_freq, int document_length, const CorpusStatistics& corpus) const {
+        return ranking_model_.ComputeScore(word_weight, term_freq, document_length, corpus_);
+    }
+
+private:
+    RankingModel ranking_model_;
+    CorpusStatistics corpus_;
+    std::map<std::string, int, std::less<>> document_freqs_;
+};
+
+template <typename StringContainer>
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const StringContainer& stop_words, bool store_positions) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("shard count must be positive");
+    }
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.emplace_back(stop_words, store_positions);
+    }
+}
+
+template <typename DocumentPredicate, typename RankingModel>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate,
+                                                            RankingModel ranking_model) const {
+    const ShardedRanking<RankingModel> sharded_ranking(ranking_model, GetCorpusStatistics(), GetDocumentFrequencies(raw_query));
+    std::vector<std::vector<Document>> shard_documents(shards_.size());
+    std::transform(std::execution::par, shards_.begin(), shards_.end(), shard_documents.begin(),
+                   [&raw_query, &document_predicate, &sharded_ranking](const SearchServer& shard) {
+                       return shard.FindTopDocuments(raw_query, document_predicate, sharded_ranking);
+                   });
+    std::vector<Document> matched_documents;
+    for (const auto& documents : shard_documents) {
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+    }
+    std::sort(matched_documents.begin(), matched_documents.end(), CompareDocuments);
+    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+    return matched_documents;
+}
@@ -0,0 +1,56 @@
+#include <algorithm>
+
+#include "stop_word_set.h"
+
+using namespace std;
+
+StopWordSet::StopWordSet(const set<string, less<>>& words) {
+    // Buckets average two words and the table is a quarter larger than the set,
+    // so a free placement for every bucket is found after a few seeds.
+    seeds_.assign(words.size() / 2 + 1, 0);
+    slots_.resize(words.size() + words.size() / 4 + 1);
+
+    vector<vector<pair<string_view, uint64_t>>> buckets(seeds_.size());
+    for (const string& word : words) {
+        const uint64_t hash = Hash(word);
+        buckets[hash % seeds_.size()].push_back({ word, hash });
+        length_mask_ |= LengthBit(word.size());
+        const auto first = static_cast<unsigned char>(word[0]);
+        first_char_mask_[first / 64] |= uint64_t(1) << (first % 64);
+    }
+
+    vector<size_t> bucket_order(buckets.size());
+    for (size_t i = 0; i < bucket_order.size(); ++i) {
+        bucket_order[i] = i;
+    }
+    sort(bucket_order.begin(), bucket_order.end(), [&buckets](size_t lhs, size_t rhs) {
+        return buckets[lhs].size() > buckets[rhs].size();
+    });
+
+    vector<bool> is_used(slots_.size(), false);
+    vector<size_t> bucket_slots;
+    for (const size_t bucket_index : bucket_order) {
+        const auto& bucket = buckets[bucket_index];
+        if (bucket.empty()) {
+            break;
+        }
+        for (uint32_t seed = 1;; ++seed) {
+            bucket_slots.clear();
+            for (const auto& [word, hash] : bucket) {
+                const size_t slot = GetSlot(hash, seed);
+                if (is_used[slot] || find(bucket_slots.begin(), bucket_slots.end(), slot) != bucket_slots.end()) {
+                    break;
+                }
+                bucket_slots.push_back(slot);
+            }
+            if (bucket_slots.size() == bucket.size()) {
+                seeds_[bucket_index] = seed;
+                for (size_t i = 0; i < bucket.size(); ++i) {
+                    is_used[bucket_slots[i]] = true;
+                    slots_[bucket_slots[i]] = string(bucket[i].first);
+                }
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Immutable set of stop words built once at construction (hash-and-displace perfect hashing):
+// every word owns a slot of the table, so a lookup hashes the word once and compares it with
+// a single candidate. Words whose length or first character no stop word has are rejected
+// before hashing.
+class StopWordSet {
+public:
+    StopWordSet() = default;
+
+    explicit StopWordSet(const std::set<std::string, std::less<>>& words);
+
+    bool Contains(const std::string_view& word) const {
+        if (word.empty() || (length_mask_ & LengthBit(word.size())) == 0) {
+            return false;
+        }
+        const auto first = static_cast<unsigned char>(word[0]);
+        if ((first_char_mask_[first / 64] & (uint64_t(1) << (first % 64))) == 0) {
+            return false;
+        }
+        const uint64_t hash = Hash(word);
+        return slots_[GetSlot(hash, seeds_[hash % seeds_.size()])] == word;
+    }
+
+private:
+    std::vector<uint32_t> seeds_;
+    std::vector<std::string> slots_;
+    uint64_t length_mask_ = 0;
+    uint64_t first_char_mask_[4] = {};
+
+    static uint64_t LengthBit(size_t length) {
+        return uint64_t(1) << (length < 63 ? length : 63);
+    }
+
+    static uint64_t Hash(const std::string_view& word) {
+        uint64_t hash = 14695981039346656037ull;
+        for (const char c : word) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    size_t GetSlot(uint64_t hash, uint32_t seed) const {
+        uint64_t mixed = (hash ^ seed) * 0x9E3779B97F4A7C15ull;
+        mixed ^= mixed >> 29;
+        return static_cast<size_t>(mixed % slots_.size());
+    }
+};
@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../rpc_protocol.h"
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+int Connect(const string& address) {
+    const size_t colon = address.rfind(':');
+    int fd = -1;
+    if (colon != string::npos && address.find('/') == string::npos) {
+        sockaddr_in socket_address{};
+        socket_address.sin_family = AF_INET;
+        socket_address.sin_port = htons(ParseTcpPort(address));
+        inet_pton(AF_INET, address.substr(0, colon).c_str(), &socket_address.sin_addr);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&socket_address), sizeof(socket_address)) < 0) {
+            close(fd);
+            fd = -1;
+        }
+        if (fd >= 0) {
+            const int enable = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        }
+    } else {
+        sockaddr_un socket_address{};
+        socket_address.sun_family = AF_UNIX;
+        strncpy(socket_address.sun_path, address.c_str(), sizeof(socket_address.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&socket_address), sizeof(socket_address)) < 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd < 0) {
+        throw runtime_error("cannot connect to "s + address + ": "s + strerror(errno));
+    }
+    return fd;
+}
+
+void WriteAll(int fd, const string& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        const ssize_t written = send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw runtime_error("send: "s + strerror(errno));
+        }
+        offset += written;
+    }
+}
+
+class ResponseReader {
+public:
+    explicit ResponseReader(int fd)
+        : fd_(fd) {
+    }
+
+    RpcResponse Read() {
+        while (true) {
+            const size_t frame_size = GetFrameSize(buffer_);
+            if (frame_size > 0) {
+                RpcResponse response = ParseResponse(GetFrameBody(string_view(buffer_).substr(0, frame_size)));
+                buffer_.erase(0, frame_size);
+                return response;
+            }
+            char chunk[64 * 1024];
+            const ssize_t read_size = read(fd_, chunk, sizeof(chunk));
+            if (read_size == 0) {
+                throw runtime_error("connection closed by server");
+            }
+            if (read_size < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw runtime_error("read: "s + strerror(errno));
+            }
+            buffer_.append(chunk, read_size);
+        }
+    }
+
+private:
+    const int fd_;
+    string buffer_;
+};
+
+string GenerateWord(mt19937& generator, int max_length) {
+    const int length = uniform_int_distribution(1, max_length)(generator);
+    string word;
+    for (int i = 0; i < length; ++i) {
+        word.push_back(uniform_int_distribution(0, 25)(generator) + 'a');
+    }
+    return word;
+}
+
+string GenerateText(mt19937& generator, const vector<string>& dictionary, int word_count) {
+    string text;
+    for (int i = 0; i < word_count; ++i) {
+        if (!text.empty()) {
+            text.push_back(' ');
+        }
+        text += dictionary[uniform_int_distribution<int>(0, int(dictionary.size()) - 1)(generator)];
+    }
+    return text;
+}
+
+// Sends requests keeping at most pipeline_depth of them in flight and returns their latencies.
+vector<double> RunPipeline(int fd, const vector<RpcRequest>& requests, size_t pipeline_depth, int& error_count) {
+    ResponseReader reader(fd);
+    map<uint32_t, Clock::time_point> send_times;
+    vector<double> latencies;
+    latencies.reserve(requests.size());
+    size_t sent = 0;
+    string output;
+    while (latencies.size() < requests.size()) {
+        output.clear();
+        while (sent < requests.size() && send_times.size() < pipeline_depth) {
+            SerializeRequest(requests[sent], output);
+            send_times[requests[sent].request_id] = Clock::now();
+            ++sent;
+        }
+        if (!output.empty()) {
+            WriteAll(fd, output);
+        }
+        const RpcResponse response = reader.Read();
+        const auto it = send_times.find(response.request_id);
+        if (it == send_times.end()) {
+            throw runtime_error("unexpected response id " + to_string(response.request_id));
+        }
+        latencies.push_back(chrono::duration<double, micro>(Clock::now() - it->second).count());
+        send_times.erase(it);
+        if (!response.is_ok) {
+            ++error_count;
+        }
+    }
+    return latencies;
+}
+
+double GetPercentile(const vector<double>& sorted_values, double percentile) {
+    if (sorted_values.empty()) {
+        return 0;
+    }
+    const size_t index = min(sorted_values.size() - 1, static_cast<size_t>(percentile / 100.0 * sorted_values.size()));
+    return sorted_values[index];
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Usage: "s << argv[0]
+             << " <socket path | 127.0.0.1:port> [connections = 8] [pipeline depth = 16]"s
+                " [queries per connection = 10000] [documents = 10000]"s << endl;
+        return 1;
+    }
+    const string address = argv[1];
+    const int connection_count = argc > 2 ? stoi(argv[2]) : 8;
+    const size_t pipeline_depth = argc > 3 ? stoul(argv[3]) : 16;
+    const int query_count = argc > 4 ? stoi(argv[4]) : 10'000;
+    const int document_count = argc > 5 ? stoi(argv[5]) : 10'000;
+
+    try {
+        mt19937 generator;
+        vector<string> dictionary;
+        for (int i = 0; i < 1'000; ++i) {
+            dictionary.push_back(GenerateWord(generator, 10));
+        }
+
+        vector<RpcRequest> additions(document_count);
+        for (int i = 0; i < document_count; ++i) {
+            additions[i].operation = RpcOperation::ADD;
+            additions[i].request_id = i;
+            additions[i].document_id = i;
+            additions[i].ratings = { 1, 2, 3 };
+            additions[i].text = GenerateText(generator, dictionary, 70);
+        }
+        int add_errors = 0;
+        const int add_fd = Connect(address);
+        const auto add_start = Clock::now();
+        RunPipeline(add_fd, additions, pipeline_depth, add_errors);
+        const double add_seconds = chrono::duration<double>(Clock::now() - add_start).count();
+        close(add_fd);
+        cout << "added "s << document_count - add_errors << " documents ("s << add_errors << " rejected) in "s
+             << add_seconds << " s"s << endl;
+
+        vector<vector<RpcRequest>> queries(connection_count);
+        for (auto& connection_queries : queries) {
+            connection_queries.resize(query_count);
+            for (int i = 0; i < query_count; ++i) {
+                connection_queries[i].operation = RpcOperation::FIND;
+                connection_queries[i].request_id = i;
+                connection_queries[i].text = GenerateText(generator, dictionary, 10);
+            }
+        }
+        vector<vector<double>> latencies(connection_count);
+        vector<int> query_errors(connection_count);
+        // An exception must not leave a worker thread, it is rethrown here after all threads finish.
+        vector<exception_ptr> thread_errors(connection_count);
+        vector<thread> threads;
+        const auto query_start = Clock::now();
+        for (int i = 0; i < connection_count; ++i) {
+            threads.emplace_back([&, i] {
+                int fd = -1;
+                try {
+                    fd = Connect(address);
+                    latencies[i] = RunPipeline(fd, queries[i], pipeline_depth, query_errors[i]);
+                } catch (...) {
+                    thread_errors[i] = current_exception();
+                }
+                if (fd >= 0) {
+                    close(fd);
+                }
+            });
+        }
+        for (thread& t : threads) {
+            t.join();
+        }
+        for (const exception_ptr& error : thread_errors) {
+            if (error) {
+                rethrow_exception(error);
+            }
+        }
+        const double query_seconds = chrono::duration<double>(Clock::now() - query_start).count();
+
+        vector<double> all_latencies;
+        for (const auto& connection_latencies : latencies) {
+            all_latencies.insert(all_latencies.end(), connection_latencies.begin(), connection_latencies.end());
+        }
+        sort(all_latencies.begin(), all_latencies.end());
+        cout << "queries: "s << all_latencies.size()
+             << ", errors: "s << accumulate(query_errors.begin(), query_errors.end(), 0)
+             << ", throughput: "s << all_latencies.size() / query_seconds << " qps"s << endl;
+        cout << "latency, us: p50 = "s << GetPercentile(all_latencies, 50)
+             << ", p90 = "s << GetPercentile(all_latencies, 90)
+             << ", p99 = "s << GetPercentile(all_latencies, 99)
+             << ", max = "s << (all_latencies.empty() ? 0 : all_latencies.back()) << endl;
+    } catch (const exception& e) {
+        cerr << "Error: "s << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
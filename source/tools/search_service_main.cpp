@@ -0,0 +1,41 @@
+#include <csignal>
+#include <iostream>
+#include <string>
+
+#include "../search_service.h"
+
+using namespace std;
+
+namespace {
+
+SearchService* running_service = nullptr;
+
+void HandleStopSignal(int) {
+    if (running_service != nullptr) {
+        running_service->Stop();
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Usage: "s << argv[0] << " <socket path | 127.0.0.1:port> [stop words]"s << endl;
+        return 1;
+    }
+    try {
+        SearchServer search_server(argc > 2 ? string(argv[2]) : string());
+        SearchService service(search_server);
+        service.Listen(argv[1]);
+        running_service = &service;
+        signal(SIGINT, HandleStopSignal);
+        signal(SIGTERM, HandleStopSignal);
+        cerr << "Listening on "s << argv[1] << endl;
+        service.Run();
+        running_service = nullptr;
+    } catch (const exception& e) {
+        cerr << "Error: "s << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
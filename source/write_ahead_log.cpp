@@ -0,0 +1,340 @@
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "write_ahead_log.h"
+
+using namespace std;
+
+namespace {
+
+const size_t RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+uint32_t ComputeCrc32(string_view data) {
+    static const array<uint32_t, 256> table = [] {
+        array<uint32_t, 256> result{};
+        for (uint32_t i = 0; i < result.size(); ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+            }
+            result[i] = value;
+        }
+        return result;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (const char c : data) {
+        crc = table[(crc ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void WriteUint32(uint32_t value, string& output) {
+    for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+        output.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+void WriteUint64(uint64_t value, string& output) {
+    WriteUint32(static_cast<uint32_t>(value), output);
+    WriteUint32(static_cast<uint32_t>(value >> 32), output);
+}
+
+class RecordReader {
+public:
+    explicit RecordReader(string_view data)
+        : data_(data) {
+    }
+
+    uint8_t ReadUint8() {
+        Require(1);
+        const uint8_t value = static_cast<uint8_t>(data_[0]);
+        data_.remove_prefix(1);
+        return value;
+    }
+
+    uint32_t ReadUint32() {
+        Require(sizeof(uint32_t));
+        uint32_t value = 0;
+        for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(data_[i])) << (8 * i);
+        }
+        data_.remove_prefix(sizeof(uint32_t));
+        return value;
+    }
+
+    uint64_t ReadUint64() {
+        const uint64_t low = ReadUint32();
+        const uint64_t high = ReadUint32();
+        return low | (high << 32);
+    }
+
+    string_view ReadBytes(size_t size) {
+        Require(size);
+        const string_view value = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return value;
+    }
+
+    bool IsEmpty() const {
+        return data_.empty();
+    }
+
+private:
+    string_view data_;
+
+    void Require(size_t size) const {
+        if (data_.size() < size) {
+            throw invalid_argument("log record is truncated");
+        }
+    }
+};
+
+LogRecord ParseLogRecord(string_view payload) {
+    RecordReader reader(payload);
+    LogRecord record;
+    record.lsn = reader.ReadUint64();
+    const uint8_t operation = reader.ReadUint8();
+    if (operation < static_cast<uint8_t>(LogOperation::ADD) || operation > static_cast<uint8_t>(LogOperation::CHECKPOINT)) {
+        throw invalid_argument("log record has unknown operation");
+    }
+    record.operation = static_cast<LogOperation>(operation);
+    record.document_id = static_cast<int>(reader.ReadUint32());
+    const uint8_t status = reader.ReadUint8();
+    if (status > static_cast<uint8_t>(DocumentStatus::REMOVED)) {
+        throw invalid_argument("log record has unknown document status");
+    }
+    record.status = static_cast<DocumentStatus>(status);
+    const uint32_t rating_count = reader.ReadUint32();
+    for (uint32_t i = 0; i < rating_count; ++i) {
+        record.ratings.push_back(static_cast<int>(reader.ReadUint32()));
+    }
+    record.text = reader.ReadBytes(reader.ReadUint32());
+    if (!reader.IsEmpty()) {
+        throw invalid_argument("log record has trailing bytes");
+    }
+    return record;
+}
+
+void WriteAll(int fd, string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw runtime_error("write: "s + strerror(errno));
+        }
+        data.remove_prefix(written);
+    }
+}
+
+void SyncDirectory(const string& path) {
+    const filesystem::path parent = filesystem::absolute(path).parent_path();
+    const int fd = open(parent.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+}  // namespace
+
+void SerializeLogRecord(const LogRecord& record, string& output) {
+    const size_t record_begin = output.size();
+    output.append(RECORD_HEADER_SIZE, '\0');
+    WriteUint64(record.lsn, output);
+    output.push_back(static_cast<char>(record.operation));
+    WriteUint32(static_cast<uint32_t>(record.document_id), output);
+    output.push_back(static_cast<char>(record.status));
+    WriteUint32(static_cast<uint32_t>(record.ratings.size()), output);
+    for (const int rating : record.ratings) {
+        WriteUint32(static_cast<uint32_t>(rating), output);
+    }
+    WriteUint32(static_cast<uint32_t>(record.text.size()), output);
+    output += record.text;
+
+    const string_view payload = string_view(output).substr(record_begin + RECORD_HEADER_SIZE);
+    string header;
+    WriteUint32(static_cast<uint32_t>(payload.size()), header);
+    WriteUint32(ComputeCrc32(payload), header);
+    output.replace(record_begin, RECORD_HEADER_SIZE, header);
+}
+
+vector<LogRecord> ParseLogRecords(string_view data, size_t& valid_size) {
+    vector<LogRecord> records;
+    valid_size = 0;
+    RecordReader reader(data);
+    while (data.size() - valid_size >= RECORD_HEADER_SIZE) {
+        const uint32_t payload_size = reader.ReadUint32();
+        const uint32_t crc = reader.ReadUint32();
+        if (data.size() - valid_size - RECORD_HEADER_SIZE < payload_size) {
+            break;
+        }
+        const string_view payload = reader.ReadBytes(payload_size);
+        if (ComputeCrc32(payload) != crc) {
+            break;
+        }
+        try {
+            records.push_back(ParseLogRecord(payload));
+        } catch (const invalid_argument&) {
+            break;
+        }
+        valid_size += RECORD_HEADER_SIZE + payload_size;
+    }
+    return records;
+}
+
+string ReadLogFile(const string& path) {
+    ifstream input(path, ios::binary);
+    if (!input) {
+        return {};
+    }
+    return string(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+}
+
+void ReplaceLogFile(const string& path, string_view data) {
+    const string temporary_path = path + ".tmp"s;
+    const int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw runtime_error("cannot create "s + temporary_path + ": "s + strerror(errno));
+    }
+    try {
+        WriteAll(fd, data);
+        if (fdatasync(fd) < 0) {
+            throw runtime_error("fdatasync: "s + strerror(errno));
+        }
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    if (rename(temporary_path.c_str(), path.c_str()) < 0) {
+        throw runtime_error("cannot replace "s + path + ": "s + strerror(errno));
+    }
+    SyncDirectory(path);
+}
+
+WriteAheadLog::WriteAheadLog(const string& path, uint64_t min_lsn)
+    : path_(path) {
+    const string data = ReadLogFile(path_);
+    size_t valid_size = 0;
+    recovered_records_ = ParseLogRecords(data, valid_size);
+    OpenForAppend();
+    if (valid_size < data.size() && ftruncate(fd_, static_cast<off_t>(valid_size)) < 0) {
+        close(fd_);
+        throw runtime_error("cannot truncate "s + path_ + ": "s + strerror(errno));
+    }
+    last_lsn_ = recovered_records_.empty() ? min_lsn : max(min_lsn, recovered_records_.back().lsn);
+    durable_lsn_ = last_lsn_;
+    flusher_ = thread([this] {
+        FlushPending();
+    });
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    {
+        lock_guard lock(mutex_);
+        is_stopped_ = true;
+    }
+    has_pending_.notify_one();
+    flusher_.join();
+    close(fd_);
+}
+
+uint64_t WriteAheadLog::Append(LogRecord record) {
+    lock_guard lock(mutex_);
+    record.lsn = ++last_lsn_;
+    SerializeLogRecord(record, pending_);
+    has_pending_.notify_one();
+    return record.lsn;
+}
+
+void WriteAheadLog::WaitDurable(uint64_t lsn) {
+    unique_lock lock(mutex_);
+    is_durable_.wait(lock, [this, lsn] {
+        return durable_lsn_ >= lsn || !error_.empty();
+    });
+    if (!error_.empty()) {
+        throw runtime_error(error_);
+    }
+}
+
+void WriteAheadLog::CheckHealth() const {
+    lock_guard lock(mutex_);
+    if (!error_.empty()) {
+        throw runtime_error(error_);
+    }
+}
+
+uint64_t WriteAheadLog::GetLastLsn() const {
+    lock_guard lock(mutex_);
+    return last_lsn_;
+}
+
+void WriteAheadLog::Truncate(uint64_t up_to_lsn) {
+    lock_guard file_lock(file_mutex_);
+    const string data = ReadLogFile(path_);
+    size_t valid_size = 0;
+    string tail;
+    for (const LogRecord& record : ParseLogRecords(data, valid_size)) {
+        if (record.lsn > up_to_lsn) {
+            SerializeLogRecord(record, tail);
+        }
+    }
+    ReplaceLogFile(path_, tail);
+    close(fd_);
+    OpenForAppend();
+}
+
+const vector<LogRecord>& WriteAheadLog::GetRecoveredRecords() const {
+    return recovered_records_;
+}
+
+void WriteAheadLog::FlushPending() {
+    unique_lock lock(mutex_);
+    while (true) {
+        has_pending_.wait(lock, [this] {
+            return is_stopped_ || !pending_.empty();
+        });
+        if (pending_.empty()) {
+            return;
+        }
+        string batch;
+        batch.swap(pending_);
+        const uint64_t batch_lsn = last_lsn_;
+        lock.unlock();
+        string error;
+        {
+            lock_guard file_lock(file_mutex_);
+            try {
+                WriteAll(fd_, batch);
+                if (fdatasync(fd_) < 0) {
+                    throw runtime_error("fdatasync: "s + strerror(errno));
+                }
+            } catch (const exception& e) {
+                error = e.what();
+            }
+        }
+        lock.lock();
+        if (!error.empty() && error_.empty()) {
+            error_ = "cannot write "s + path_ + ": "s + error;
+        }
+        durable_lsn_ = batch_lsn;
+        is_durable_.notify_all();
+    }
+}
+
+void WriteAheadLog::OpenForAppend() {
+    fd_ = open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw runtime_error("cannot open "s + path_ + ": "s + strerror(errno));
+    }
+}
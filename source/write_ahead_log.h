@@ -0,0 +1,99 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+
+// A log file is a sequence of records: u32 payload length, u32 CRC-32 of the payload, payload.
+// Payload: lsn (u64), operation (u8), document id (i32), status (u8), ratings (u32 count, i32 each),
+// text (u32 length, bytes). Integers are little-endian.
+
+enum class LogOperation : uint8_t {
+    ADD = 1,
+    REMOVE = 2,
+    // First record of a snapshot file: lsn is the last record the snapshot covers,
+    // document_id is the number of ADD records that follow.
+    CHECKPOINT = 3,
+};
+
+struct LogRecord {
+    uint64_t lsn = 0;
+    LogOperation operation = LogOperation::ADD;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    std::string text;
+};
+
+void SerializeLogRecord(const LogRecord& record, std::string& output);
+
+// Parses records up to the end of data or the first torn or corrupted record.
+// valid_size receives the number of bytes taken by the parsed records.
+std::vector<LogRecord> ParseLogRecords(std::string_view data, size_t& valid_size);
+
+// Reads the whole file, an absent file has no records.
+std::string ReadLogFile(const std::string& path);
+
+// Writes data to path through a temporary file, so a crash leaves either the old or the new file.
+void ReplaceLogFile(const std::string& path, std::string_view data);
+
+// Append-only log of index mutations. Append only queues a record; a background thread
+// writes everything queued so far and syncs it with one fdatasync (group commit),
+// so concurrent writers share the cost of a sync.
+class WriteAheadLog {
+public:
+    // Opens or creates the log, cuts off a torn tail left by a crash.
+    // LSNs continue after the last record or after min_lsn, whichever is greater.
+    WriteAheadLog(const std::string& path, uint64_t min_lsn = 0);
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Syncs the queued records and stops the background thread.
+    ~WriteAheadLog();
+
+    // Assigns the next LSN to record, queues it and returns the LSN.
+    uint64_t Append(LogRecord record);
+
+    // Blocks until every record up to lsn is on disk. Throws runtime_error if writing failed.
+    void WaitDurable(uint64_t lsn);
+
+    // Throws runtime_error if an earlier write or sync failed. The log stays failed until it is reopened.
+    void CheckHealth() const;
+
+    uint64_t GetLastLsn() const;
+
+    // Drops the records with lsn <= up_to_lsn, once a snapshot covers them.
+    void Truncate(uint64_t up_to_lsn);
+
+    // Records that survived in the file when the log was opened.
+    const std::vector<LogRecord>& GetRecoveredRecords() const;
+
+private:
+    const std::string path_;
+    int fd_ = -1;
+    std::vector<LogRecord> recovered_records_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable has_pending_;
+    std::condition_variable is_durable_;
+    std::string pending_;
+    uint64_t last_lsn_ = 0;
+    uint64_t durable_lsn_ = 0;
+    std::string error_;
+    bool is_stopped_ = false;
+
+    // Held while the file is written or replaced.
+    std::mutex file_mutex_;
+    std::thread flusher_;
+
+    void FlushPending();
+
+    void OpenForAppend();
+};